@@ -0,0 +1,655 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ex/aligned_buffer.h>
+#include <ex/bit_reader.h>
+#include <ex/bit_writer.h>
+#include <ex/buffer.h>
+#include <ex/buffer_hash.h>
+#include <ex/buffer_pool.h>
+#include <ex/buffer_reader.h>
+#include <ex/buffer_utils.h>
+#include <ex/buffer_writer.h>
+#include <ex/crc.h>
+#include <ex/hexdump.h>
+#include <ex/mapped_buffer.h>
+#include <ex/mirrored_ring_buffer.h>
+#include <ex/pmr_buffer.h>
+#include <ex/ring_buffer.h>
+#include <ex/shared_buffer.h>
+#include <ex/static_buffer.h>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// Prints one JSON object per line:
+//   {"name":"hex/encode","size":4096,"iterations":...,"ns_per_op":...,
+//    "gb_per_s":...}
+// Options: --filter=<substring> --max-size=<bytes> --min-time-ms=<ms>
+//          --tlb[=<bytes>]  also run the huge-page TLB benchmark over a
+//                           working set of <bytes> (default 1 GB, rounded
+//                           up to a power of two)
+
+namespace {
+
+struct options {
+  std::string filter;
+  size_t max_size = size_t(64) << 20;
+  double min_time_ns = 1e8;
+  size_t tlb_size = 0;
+};
+
+options opts;
+
+template <typename T> inline void do_not_optimize(const T &v) {
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile("" : : "r,m"(v) : "memory");
+#else
+  static volatile T sink;
+  sink = v;
+#endif
+}
+
+void run(const std::string &name, size_t size,
+         const std::function<void()> &f) {
+  if (size > opts.max_size)
+    return;
+  if (!opts.filter.empty() && name.find(opts.filter) == std::string::npos)
+    return;
+  using clock = std::chrono::steady_clock;
+  f();
+  size_t iters = 1;
+  double ns = 0;
+  for (;;) {
+    auto start = clock::now();
+    for (size_t i = 0; i < iters; ++i)
+      f();
+    ns = std::chrono::duration<double, std::nano>(clock::now() - start)
+             .count();
+    if (ns >= opts.min_time_ns || iters >= (size_t(1) << 30))
+      break;
+    auto scale = ns > 0 ? opts.min_time_ns / ns * 1.2 : 10.0;
+    scale = std::min(scale, 10.0);
+    iters = std::max(iters + 1, size_t(double(iters) * scale));
+  }
+  auto per_op = ns / double(iters);
+  std::printf("{\"name\":\"%s\",\"size\":%zu,\"iterations\":%zu,"
+              "\"ns_per_op\":%.3f,\"gb_per_s\":%.3f}\n",
+              name.c_str(), size, iters, per_op, double(size) / per_op);
+  std::fflush(stdout);
+}
+
+ex::buffer pattern(size_t size) {
+  auto b = ex::buffer(size);
+  for (size_t i = 0; i < size; ++i)
+    b[i] = static_cast<uint8_t>(i * 131 + 17);
+  return b;
+}
+
+template <typename T> T legacy_switch_endian(T t) {
+  auto p = reinterpret_cast<uint8_t *>(&t);
+  std::reverse(p, p + sizeof(T));
+  return t;
+}
+
+void bench_hex(size_t size) {
+  auto b = pattern(size);
+  auto hex = b.to_hex_string();
+  auto split = b.to_hex_string(":");
+  auto out = ex::buffer(size);
+  run("hex/encode", size, [&] { do_not_optimize(b.to_hex_string()); });
+  run("hex/encode_split", size,
+      [&] { do_not_optimize(b.to_hex_string(":")); });
+  run("hex/decode", size, [&] {
+    do_not_optimize(ex::buffer_write_hex(out.data(), hex, true));
+    do_not_optimize(out.data());
+  });
+  run("hex/decode_split", size, [&] {
+    do_not_optimize(ex::buffer_write_hex(out.data(), split));
+    do_not_optimize(out.data());
+  });
+  run("hex/from_hex", size,
+      [&] { do_not_optimize(ex::buffer::from_hex(hex).data()); });
+  run("hex/from_hex/zeroing", size, [&] {
+    ex::buffer b(size);
+    ex::buffer_write_hex(b.data(), hex);
+    do_not_optimize(b.data());
+  });
+}
+
+template <typename T> void bench_endian(const char *type, size_t size) {
+  auto count = size / sizeof(T);
+  if (!count)
+    return;
+  auto b = pattern(count * sizeof(T) + 1);
+  ex::shared_buffer sb(b);
+  std::vector<T> values(count);
+  auto bytes = count * sizeof(T);
+  auto name = [&](const char *op) {
+    return std::string("endian/") + op + "<" + type + ">";
+  };
+  run(name("read_be"), bytes, [&] {
+    T sum = 0;
+    for (size_t i = 0; i < count; ++i)
+      sum += b.read_be<T>(i * sizeof(T));
+    do_not_optimize(sum);
+  });
+  run(name("read_be") + "/legacy", bytes, [&] {
+    T sum = 0;
+    for (size_t i = 0; i < count; ++i)
+      sum += legacy_switch_endian(
+          *reinterpret_cast<T *>(b.data() + i * sizeof(T)));
+    do_not_optimize(sum);
+  });
+  run(name("read_le_unaligned"), bytes, [&] {
+    T sum = 0;
+    for (size_t i = 0; i < count; ++i)
+      sum += sb.read_le<T>(1 + i * sizeof(T));
+    do_not_optimize(sum);
+  });
+  run(name("write_be"), bytes, [&] {
+    for (size_t i = 0; i < count; ++i)
+      b.write_be(static_cast<T>(i), i * sizeof(T));
+    do_not_optimize(b.data());
+  });
+  run(name("write_be") + "/legacy", bytes, [&] {
+    for (size_t i = 0; i < count; ++i) {
+      auto p = b.data() + i * sizeof(T);
+      *reinterpret_cast<T *>(p) = static_cast<T>(i);
+      std::reverse(p, p + sizeof(T));
+    }
+    do_not_optimize(b.data());
+  });
+  run(name("read_be_n"), bytes, [&] {
+    b.read_be_n(values.data(), count);
+    do_not_optimize(values.data());
+  });
+  run(name("write_be_n"), bytes, [&] {
+    sb.write_be_n(values.data(), count);
+    do_not_optimize(b.data());
+  });
+}
+
+void bench_from(size_t size) {
+  auto src = pattern(size);
+  std::vector<uint8_t> vec(src.begin(), src.end());
+  std::string str(src.begin(), src.end());
+  run("from/ptr", size,
+      [&] { do_not_optimize(ex::buffer::from(vec.data(), size).data()); });
+  run("from/ptr/zeroing", size, [&] {
+    std::vector<uint8_t> v(size);
+    std::copy(vec.begin(), vec.end(), v.begin());
+    do_not_optimize(v.data());
+  });
+  run("from/vector", size,
+      [&] { do_not_optimize(ex::buffer::from(vec).data()); });
+  run("from/vector_length", size,
+      [&] { do_not_optimize(ex::buffer::from(vec, size).data()); });
+  run("from/string", size,
+      [&] { do_not_optimize(ex::buffer::from(str).data()); });
+  if (size <= 512) {
+    run("from/static_buffer", size, [&] {
+      auto b = ex::static_buffer<512>::from(vec.data(), size);
+      do_not_optimize(b.data());
+    });
+  }
+  run("from/small_buffer", size, [&] {
+    auto b = ex::small_buffer<512>::from(vec.data(), size);
+    do_not_optimize(b.data());
+  });
+}
+
+void bench_alloc(size_t size) {
+  auto src = pattern(size);
+  run("alloc/buffer", size, [&] {
+    auto b = ex::buffer::from(src.data(), size);
+    do_not_optimize(b.data());
+  });
+  auto &pool = ex::thread_pool();
+  run("alloc/pmr_thread_pool", size, [&] {
+    auto b = ex::pmr_buffer::from(src.data(), size, &pool);
+    do_not_optimize(b.data());
+  });
+  // Released every 64 buffers, as a per-request arena would be.
+  auto &arena = ex::thread_arena();
+  size_t live = 0;
+  run("alloc/pmr_thread_arena", size, [&] {
+    {
+      auto b = ex::pmr_buffer::from(src.data(), size, &arena);
+      do_not_optimize(b.data());
+    }
+    if (++live % 64 == 0)
+      arena.release();
+  });
+  arena.release();
+}
+
+void bench_pool(size_t size) {
+  ex::buffer_pool pool(size);
+  run("pool/acquire", size, [&] {
+    auto b = pool.acquire();
+    do_not_optimize(b->data());
+  });
+  run("pool/acquire/buffer", size, [&] {
+    auto b = ex::basic_buffer<>::uninitialized(size);
+    do_not_optimize(b.data());
+  });
+}
+
+// One handoff: the producer side writes `size` bytes and the consumer
+// side reads them back, on one thread so the figure is the per-handoff
+// overhead rather than scheduler noise.
+void bench_ring(size_t size) {
+  if (size > (size_t(1) << 20))
+    return;
+  auto src = pattern(size);
+  auto dst = ex::buffer(size);
+  ex::ring_buffer ring(size_t(1) << 20);
+  run("ring/spsc", size, [&] {
+    ring.write(src.data(), size);
+    ring.read(dst.data(), size);
+    do_not_optimize(dst.data());
+  });
+
+  ex::mirrored_ring_buffer mirrored(size_t(1) << 20);
+  run("ring/mirrored", size, [&] {
+    mirrored.write(src.data(), size);
+    mirrored.read(dst.data(), size);
+    do_not_optimize(dst.data());
+  });
+  // Parsing fixed 8-byte headers in place, which straddle the wrap point
+  // every capacity() bytes.
+  if (size >= 8) {
+    run("ring/mirrored/read_be", size, [&] {
+      mirrored.write(src.data(), size);
+      uint64_t sum = 0;
+      auto r = mirrored.read_region(size);
+      for (size_t i = 0; i + 8 <= size; i += 8)
+        sum += r.read_be<uint64_t>(i);
+      mirrored.commit_read(size);
+      do_not_optimize(sum);
+    });
+  }
+
+  std::mutex m;
+  std::vector<uint8_t> queue;
+  run("ring/spsc/mutex_vector", size, [&] {
+    {
+      std::lock_guard<std::mutex> lock(m);
+      queue.insert(queue.end(), src.begin(), src.end());
+    }
+    std::lock_guard<std::mutex> lock(m);
+    std::copy(queue.begin(), queue.end(), dst.begin());
+    queue.clear();
+    do_not_optimize(dst.data());
+  });
+}
+
+// Open a file and read it end to end as big-endian 64-bit words.
+void bench_mapped(size_t size) {
+  if (size < 8)
+    return;
+  char path[] = "/tmp/ex_bench_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0)
+    return;
+  close(fd);
+  {
+    auto src = pattern(size);
+    auto file = ex::mapped_buffer::open_readwrite(path, size);
+    file.fill(src);
+  }
+  auto count = size / 8;
+  run("mapped/scan", size, [&] {
+    auto file = ex::mapped_buffer::open_readonly(path);
+    file.advise(ex::map_advice::sequential);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; ++i)
+      sum += file.read_be<uint64_t>(i * 8);
+    do_not_optimize(sum);
+  });
+  run("mapped/scan/fread", size, [&] {
+    auto f = std::fopen(path, "rb");
+    auto b = ex::basic_buffer<>::uninitialized(size);
+    auto n = std::fread(b.data(), 1, size, f);
+    std::fclose(f);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n / 8; ++i)
+      sum += b.read_be<uint64_t>(i * 8);
+    do_not_optimize(sum);
+  });
+  unlink(path);
+}
+
+// Decode `size` varints of one to three bytes, mostly short, as in
+// protobuf field tags and lengths. Sized by the integer count, so gb_per_s
+// reads as billions of integers per second. Each call decodes the next
+// block of a pool of at least 1M integers, so small sizes do not replay
+// one input that the branch predictor has learned.
+void bench_varint(size_t size) {
+  if (size < 64)
+    return;
+  auto total = std::max(size, size_t(1) << 20);
+  ex::buffer encoded;
+  std::vector<size_t> starts;
+  {
+    ex::buffer_writer w(encoded, total * 3);
+    uint32_t x = 1;
+    for (size_t i = 0; i < total; ++i) {
+      if (i % size == 0)
+        starts.push_back(w.position());
+      x = x * 1664525 + 1013904223;
+      auto len = x >> 29;
+      w.write_varint(x & (len < 6 ? 0x7f : len < 7 ? 0x3fff : 0x1fffff));
+    }
+    starts.push_back(w.position());
+  }
+  size_t block = 0;
+  auto next = [&] {
+    auto i = block;
+    block = (block + 1) % (starts.size() - 1);
+    return ex::shared_buffer(encoded.data() + starts[i],
+                             starts[i + 1] - starts[i]);
+  };
+  std::vector<uint64_t> out(size);
+  run("varint/decode_batch", size, [&] {
+    auto in = next();
+    do_not_optimize(
+        ex::buffer_read_varints(in.data(), in.size(), out.data(), size));
+    do_not_optimize(out.data());
+  });
+  run("varint/decode", size, [&] {
+    ex::buffer_reader r(next());
+    for (auto &v : out)
+      r.try_read_varint(v);
+    do_not_optimize(out.data());
+  });
+  run("varint/decode/naive", size, [&] {
+    auto p = next().data();
+    for (auto &v : out) {
+      uint64_t r = 0;
+      for (unsigned shift = 0;; shift += 7) {
+        auto b = *p++;
+        r |= uint64_t(b & 0x7f) << shift;
+        if (b < 0x80)
+          break;
+      }
+      v = r;
+    }
+    do_not_optimize(out.data());
+  });
+}
+
+// Unpack telemetry-style fields of 1 to 17 bits. Sized by the packed
+// bytes.
+void bench_bits(size_t size) {
+  if (size < 64)
+    return;
+  static const unsigned widths[] = {3, 11, 13, 1, 7, 12, 17, 2};
+  auto packed = pattern(size);
+  size_t fields = 0;
+  for (size_t bits = 0; bits + 17 <= size * 8; ++fields)
+    bits += widths[fields % 8];
+  run("bits/read", size, [&] {
+    ex::bit_reader r(packed);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < fields; ++i)
+      sum += r.read(widths[i % 8]);
+    do_not_optimize(sum);
+  });
+  run("bits/read/lsb", size, [&] {
+    ex::lsb_bit_reader r(packed);
+    uint64_t sum = 0;
+    for (size_t i = 0; i < fields; ++i)
+      sum += r.read(widths[i % 8]);
+    do_not_optimize(sum);
+  });
+  // The hand-written loop the bit reader replaced.
+  ex::shared_buffer sb(packed);
+  run("bits/read/per_bit", size, [&] {
+    uint64_t sum = 0;
+    size_t pos = 0;
+    for (size_t i = 0; i < fields; ++i) {
+      uint64_t v = 0;
+      for (unsigned n = widths[i % 8]; n; --n, ++pos)
+        v = v << 1 | (sb.at(pos / 8) >> (7 - pos % 8) & 1);
+      sum += v;
+    }
+    do_not_optimize(sum);
+  });
+  auto out = ex::buffer(size);
+  run("bits/write", size, [&] {
+    ex::bit_writer w(out);
+    for (size_t i = 0; i < fields; ++i)
+      w.write(i, widths[i % 8]);
+    w.finish();
+    do_not_optimize(out.data());
+  });
+}
+
+void bench_crc(size_t size) {
+  auto b = pattern(size);
+  run("crc/crc32c", size, [&] { do_not_optimize(ex::crc32c(b)); });
+  run("crc/crc32", size, [&] { do_not_optimize(ex::crc32(b)); });
+  run("crc/crc16_modbus", size, [&] { do_not_optimize(ex::crc16_modbus(b)); });
+  // The byte-at-a-time table loop the accelerated paths replaced.
+  run("crc/crc32/legacy", size, [&] {
+    uint32_t crc = ~uint32_t(0);
+    for (auto c : b)
+      crc = (crc >> 8) ^ ex::_crc_::crc32_ieee_tables.t[0][(crc ^ c) & 0xff];
+    do_not_optimize(~crc);
+  });
+}
+
+void bench_hash(size_t size) {
+  auto b = pattern(size);
+  std::string_view sv(reinterpret_cast<const char *>(b.data()), size);
+  run("hash/buffer_hash", size, [&] { do_not_optimize(ex::buffer_hash(b)); });
+  run("hash/std_string_view", size,
+      [&] { do_not_optimize(std::hash<std::string_view>{}(sv)); });
+  // The byte-at-a-time FNV-1a hasher callers wrote before.
+  run("hash/buffer_hash/legacy", size, [&] {
+    uint64_t h = 0xcbf29ce484222325;
+    for (auto c : b)
+      h = (h ^ c) * 0x100000001b3;
+    do_not_optimize(h);
+  });
+}
+
+void bench_find(size_t size) {
+  // Lowercase text with the needles only at the end, so each search scans
+  // the whole buffer.
+  auto b = ex::buffer(size);
+  for (size_t i = 0; i < size; ++i)
+    b[i] = static_cast<uint8_t>('a' + i * 7 % 23);
+  if (size >= 3)
+    memcpy(b.data() + size - 3, "xyz", 3);
+  std::string_view text(reinterpret_cast<const char *>(b.data()), size);
+  run("find/byte", size, [&] { do_not_optimize(b.find('z')); });
+  run("find/byte/std_find", size,
+      [&] { do_not_optimize(std::find(b.begin(), b.end(), 'z')); });
+  run("find/byte/memchr", size,
+      [&] { do_not_optimize(memchr(b.data(), 'z', size)); });
+  run("find/pattern", size, [&] { do_not_optimize(b.find("xyz")); });
+  run("find/pattern/std_search", size, [&] {
+    std::string_view xyz("xyz");
+    do_not_optimize(
+        std::search(text.begin(), text.end(), xyz.begin(), xyz.end()));
+  });
+  run("find/first_of", size, [&] { do_not_optimize(b.find_first_of(":zy")); });
+  run("find/first_of/std", size,
+      [&] { do_not_optimize(text.find_first_of(":zy")); });
+
+  // Line framing: a newline every 64 bytes.
+  auto lines = b;
+  for (size_t i = 63; i < size; i += 64)
+    lines[i] = '\n';
+  run("find/split", size, [&] {
+    size_t n = 0;
+    for (auto line : lines.split('\n'))
+      n += line.size();
+    do_not_optimize(n);
+  });
+  run("find/split/per_byte", size, [&] {
+    size_t n = 0, start = 0;
+    for (size_t i = 0; i < size; ++i)
+      if (lines[i] == '\n') {
+        n += i - start;
+        start = i + 1;
+      }
+    do_not_optimize(n + size - start);
+  });
+}
+
+void bench_fill(size_t size) {
+  auto src = pattern(size);
+  std::vector<uint8_t> vec(src.begin(), src.end());
+  auto b = ex::buffer(size);
+  ex::shared_buffer sb(b);
+  run("fill/buffer_ptr", size, [&] {
+    b.fill(vec.data(), 0, size);
+    do_not_optimize(b.data());
+  });
+  run("fill/buffer_container", size, [&] {
+    b.fill(vec);
+    do_not_optimize(b.data());
+  });
+  run("fill/shared_buffer_ptr", size, [&] {
+    sb.fill(vec.data(), 0, size);
+    do_not_optimize(b.data());
+  });
+  run("fill/shared_buffer_container", size, [&] {
+    sb.fill(vec);
+    do_not_optimize(b.data());
+  });
+  if (size == 8) {
+    run("fill/initializer_list", size, [&] {
+      b.fill({1, 2, 3, 4, 5, 6, 7, 8});
+      do_not_optimize(b.data());
+    });
+  }
+}
+
+void bench_iterate(size_t size) {
+  auto b = pattern(size);
+  ex::shared_buffer sb(b);
+  run("iterate/buffer", size, [&] {
+    uint32_t sum = 0;
+    for (auto c : b)
+      sum += c;
+    do_not_optimize(sum);
+  });
+  run("iterate/shared_buffer", size, [&] {
+    uint32_t sum = 0;
+    for (auto c : sb)
+      sum += c;
+    do_not_optimize(sum);
+  });
+}
+
+void bench_ostream(size_t size) {
+  auto b = pattern(size);
+  ex::shared_buffer sb(b);
+  run("ostream/buffer", size, [&] {
+    std::ostringstream os;
+    os << b;
+    do_not_optimize(os.tellp());
+  });
+  run("ostream/shared_buffer", size, [&] {
+    std::ostringstream os;
+    os << sb;
+    do_not_optimize(os.tellp());
+  });
+  ex::hexdump_options canonical;
+  canonical.style = ex::hexdump_style::canonical;
+  run("hexdump/canonical", size,
+      [&] { do_not_optimize(b.hexdump(canonical).data()); });
+}
+
+// Dependent random 8-byte reads over a large working set: nearly every
+// read misses the TLB with 4 KB pages. Sized by the number of bytes read.
+void bench_tlb(size_t working_set) {
+  size_t size = 1;
+  while (size < working_set)
+    size <<= 1;
+  constexpr size_t reads = size_t(1) << 20;
+  auto mask = (size - 1) & ~size_t(7);
+  auto prefix = "tlb/chase/" + std::to_string(size >> 20) + "MB/";
+  auto chase = [&](const std::string &name, auto &b) {
+    for (size_t i = 0; i < size; i += 4096)
+      b.template write_le<uint64_t>(i * 0x9e3779b97f4a7c15ull, i);
+    run(prefix + name, reads * 8, [&] {
+      uint64_t pos = 0, sum = 0;
+      for (size_t i = 0; i < reads; ++i) {
+        auto v = b.template read_le<uint64_t>(pos);
+        sum += v;
+        pos = ((pos ^ v ^ i) * 0x9e3779b97f4a7c15ull >> 17) & mask;
+      }
+      do_not_optimize(sum);
+    });
+  };
+  {
+    ex::buffer b(size);
+    chase("buffer", b);
+  }
+  {
+    ex::huge_page_buffer b(size);
+    chase("huge_page_buffer", b);
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    if (a.rfind("--filter=", 0) == 0)
+      opts.filter = a.substr(9);
+    else if (a.rfind("--max-size=", 0) == 0)
+      opts.max_size = std::strtoull(a.c_str() + 11, nullptr, 10);
+    else if (a.rfind("--min-time-ms=", 0) == 0)
+      opts.min_time_ns = std::strtod(a.c_str() + 14, nullptr) * 1e6;
+    else if (a == "--tlb")
+      opts.tlb_size = size_t(1) << 30;
+    else if (a.rfind("--tlb=", 0) == 0)
+      opts.tlb_size = std::strtoull(a.c_str() + 6, nullptr, 10);
+  }
+
+  const size_t sizes[] = {
+      8, 64, 512, size_t(4) << 10, size_t(64) << 10, size_t(1) << 20,
+      size_t(64) << 20,
+  };
+  for (auto size : sizes) {
+    if (size > opts.max_size)
+      continue;
+    bench_hex(size);
+    bench_endian<uint16_t>("uint16_t", size);
+    bench_endian<uint32_t>("uint32_t", size);
+    bench_endian<uint64_t>("uint64_t", size);
+    bench_endian<float>("float", size);
+    bench_endian<double>("double", size);
+    bench_from(size);
+    bench_alloc(size);
+    bench_pool(size);
+    bench_ring(size);
+    bench_mapped(size);
+    bench_varint(size);
+    bench_bits(size);
+    bench_crc(size);
+    bench_hash(size);
+    bench_find(size);
+    bench_fill(size);
+    bench_iterate(size);
+    bench_ostream(size);
+  }
+  if (opts.tlb_size)
+    bench_tlb(opts.tlb_size);
+  return 0;
+}
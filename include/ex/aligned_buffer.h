@@ -0,0 +1,127 @@
+#pragma once
+
+#include "buffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+
+namespace ex {
+
+// Allocates on an Align-byte boundary (a power of two) with the C++17
+// aligned operator new.
+template <typename T, size_t Align> struct aligned_allocator {
+  static_assert((Align & (Align - 1)) == 0, "Align must be a power of two");
+  static_assert(Align >= alignof(T), "Align is weaker than alignof(T)");
+
+  using value_type = T;
+  template <typename U> struct rebind {
+    using other = aligned_allocator<U, Align>;
+  };
+
+  aligned_allocator() = default;
+  template <typename U>
+  constexpr aligned_allocator(const aligned_allocator<U, Align> &) noexcept {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(
+        ::operator new(n * sizeof(T), std::align_val_t(Align)));
+  }
+
+  void deallocate(T *p, size_t) noexcept {
+    ::operator delete(p, std::align_val_t(Align));
+  }
+
+  template <typename U>
+  bool operator==(const aligned_allocator<U, Align> &) const noexcept {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const aligned_allocator<U, Align> &) const noexcept {
+    return false;
+  }
+};
+
+namespace _aligned_buffer_ {
+constexpr size_t huge_page = size_t(2) << 20;
+
+static inline size_t round_huge(size_t n) {
+  return (n + huge_page - 1) & ~(huge_page - 1);
+}
+
+// 2 MB-aligned anonymous memory: explicit huge pages when the system has
+// them reserved, else transparent huge pages requested with madvise.
+static inline void *map_huge(size_t size) {
+#ifdef MAP_HUGETLB
+  auto hp = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (hp != MAP_FAILED)
+    return hp;
+#endif
+  auto raw = mmap(nullptr, size + huge_page, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED)
+    throw std::bad_alloc();
+  auto begin = reinterpret_cast<uintptr_t>(raw);
+  auto aligned = (begin + huge_page - 1) & ~(huge_page - 1);
+  if (aligned != begin)
+    munmap(raw, aligned - begin);
+  if (auto tail = huge_page - (aligned - begin))
+    munmap(reinterpret_cast<void *>(aligned + size), tail);
+  auto p = reinterpret_cast<void *>(aligned);
+#ifdef MADV_HUGEPAGE
+  madvise(p, size, MADV_HUGEPAGE);
+#endif
+  return p;
+}
+} // namespace _aligned_buffer_
+
+// Allocations of at least 2 MB are 2 MB-aligned mappings backed by huge
+// pages where the kernel provides them, which cuts TLB misses on large
+// working sets. Smaller ones are cache-line aligned heap blocks.
+template <typename T> struct huge_page_allocator {
+  using value_type = T;
+
+  huge_page_allocator() = default;
+  template <typename U>
+  constexpr huge_page_allocator(const huge_page_allocator<U> &) noexcept {}
+
+  T *allocate(size_t n) {
+    auto size = n * sizeof(T);
+    if (size < _aligned_buffer_::huge_page)
+      return static_cast<T *>(::operator new(size, std::align_val_t(64)));
+    return static_cast<T *>(
+        _aligned_buffer_::map_huge(_aligned_buffer_::round_huge(size)));
+  }
+
+  void deallocate(T *p, size_t n) noexcept {
+    auto size = n * sizeof(T);
+    if (size < _aligned_buffer_::huge_page)
+      ::operator delete(p, std::align_val_t(64));
+    else
+      munmap(p, _aligned_buffer_::round_huge(size));
+  }
+
+  template <typename U>
+  bool operator==(const huge_page_allocator<U> &) const noexcept {
+    return true;
+  }
+  template <typename U>
+  bool operator!=(const huge_page_allocator<U> &) const noexcept {
+    return false;
+  }
+};
+
+// ex::buffer whose data() is Align-aligned, e.g. for AVX-512 loads or DMA:
+//
+//   auto b = ex::aligned_buffer<64>::from(p, n);
+template <size_t Align>
+using aligned_buffer =
+    basic_buffer<default_init_allocator<uint8_t,
+                                        aligned_allocator<uint8_t, Align>>>;
+
+using cache_aligned_buffer = aligned_buffer<64>;
+using page_aligned_buffer = aligned_buffer<4096>;
+using huge_page_buffer =
+    basic_buffer<default_init_allocator<uint8_t, huge_page_allocator<uint8_t>>>;
+} // namespace ex
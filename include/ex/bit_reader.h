@@ -0,0 +1,159 @@
+#pragma once
+
+#include "buffer.h"
+#include "buffer_utils.h"
+#include "shared_buffer.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ex {
+
+// msb_first: the first field sits in the high bits of the first byte
+// (MPEG-TS, H.264, most network headers). lsb_first: it sits in the low
+// bits (CAN signals in Intel order, DEFLATE).
+enum class bit_order { msb_first, lsb_first };
+
+// Reads fields of 1 to 64 bits. A 64-bit window is refilled with one
+// unaligned load, so a read is a shift and a mask rather than a loop over
+// bits. Reading past the end sets a sticky error and returns 0.
+//
+//   ex::bit_reader r(packet);
+//   auto sync = r.read(8);
+//   auto pusi = r.read(1);
+//   r.skip(1);
+//   auto pid = r.read(13);
+template <bit_order Order = bit_order::msb_first> class basic_bit_reader {
+public:
+  basic_bit_reader(const void *data, size_t size)
+      : m_begin(static_cast<const uint8_t *>(data)), m_ptr(m_begin),
+        m_end(m_begin + size) {}
+
+  explicit basic_bit_reader(const shared_buffer &b)
+      : basic_bit_reader(b.data(), b.size()) {}
+
+  explicit basic_bit_reader(const buffer &b)
+      : basic_bit_reader(b.data(), b.size()) {}
+
+  uint64_t read(unsigned n) {
+    assert(n >= 1 && n <= 64);
+    if (n > max_window) {
+      if (Order == bit_order::msb_first) {
+        auto high = read(n - 32);
+        return high << 32 | read(32);
+      }
+      auto low = read(32);
+      return low | read(n - 32) << 32;
+    }
+    if (m_bits < n && !refill(n))
+      return 0;
+    auto v = take(n);
+    m_window = Order == bit_order::msb_first ? m_window << n : m_window >> n;
+    m_bits -= n;
+    return v;
+  }
+
+  // Sign-extends an n-bit two's complement field.
+  int64_t read_signed(unsigned n) {
+    auto v = read(n);
+    return n == 64 ? static_cast<int64_t>(v)
+                   : static_cast<int64_t>(v << (64 - n)) >> (64 - n);
+  }
+
+  bool try_read(unsigned n, uint64_t &v) {
+    v = read(n);
+    return !m_error;
+  }
+
+  // Up to 56 bits without consuming them.
+  uint64_t peek(unsigned n) {
+    assert(n >= 1 && n <= max_window);
+    if (m_bits < n && !refill(n))
+      return 0;
+    return take(n);
+  }
+
+  void skip(size_t n) {
+    if (n <= m_bits) {
+      m_window = Order == bit_order::msb_first ? m_window << n : m_window >> n;
+      m_bits -= static_cast<unsigned>(n);
+    } else {
+      seek(position() + n);
+    }
+  }
+
+  // Skips to the next byte boundary.
+  void align() { skip(m_bits % 8); }
+
+  // In bits from the start.
+  void seek(size_t position) {
+    if (position > size()) {
+      m_error = true;
+      return;
+    }
+    m_ptr = m_begin + position / 8;
+    m_window = 0;
+    m_bits = 0;
+    if (auto bits = static_cast<unsigned>(position % 8))
+      read(bits);
+  }
+
+  // In bits.
+  size_t position() const {
+    return static_cast<size_t>(m_ptr - m_begin) * 8 - m_bits;
+  }
+  size_t remaining() const { return size() - position(); }
+  size_t size() const { return static_cast<size_t>(m_end - m_begin) * 8; }
+
+  bool ok() const { return !m_error; }
+  bool failed() const { return m_error; }
+  void clear_error() { m_error = false; }
+
+private:
+  // A refill leaves at least 56 bits in the window.
+  static constexpr unsigned max_window = 56;
+
+  uint64_t take(unsigned n) const {
+    if (Order == bit_order::msb_first)
+      return m_window >> (64 - n);
+    return m_window & (~uint64_t(0) >> (64 - n));
+  }
+
+  // Tops the window up to 56-63 bits. With 8 bytes left this is one load:
+  // the bytes it could not fit whole are loaded again, into the same bit
+  // positions, by the next refill.
+  bool refill(unsigned n) {
+    if (m_end - m_ptr >= 8) {
+      if (Order == bit_order::msb_first)
+        m_window |= buffer_read_be<uint64_t>(m_ptr) >> m_bits;
+      else
+        m_window |= buffer_read_le<uint64_t>(m_ptr) << m_bits;
+      m_ptr += (63 - m_bits) >> 3;
+      m_bits |= 56;
+      return true;
+    }
+    while (m_bits <= 56 && m_ptr < m_end) {
+      if (Order == bit_order::msb_first)
+        m_window |= uint64_t(*m_ptr++) << (56 - m_bits);
+      else
+        m_window |= uint64_t(*m_ptr++) << m_bits;
+      m_bits += 8;
+    }
+    if (m_bits >= n)
+      return true;
+    m_error = true;
+    return false;
+  }
+
+  const uint8_t *m_begin;
+  const uint8_t *m_ptr;
+  const uint8_t *m_end;
+  uint64_t m_window = 0;
+  unsigned m_bits = 0;
+  bool m_error = false;
+};
+
+using bit_reader = basic_bit_reader<>;
+using lsb_bit_reader = basic_bit_reader<bit_order::lsb_first>;
+} // namespace ex
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "bit_reader.h"
+#include "buffer.h"
+#include "buffer_utils.h"
+#include "shared_buffer.h"
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace ex {
+
+// Writes fields of 1 to 64 bits into a fixed region. Bits collect in a
+// 64-bit accumulator that is stored 32 bits at a time, so bytes past the
+// cursor are never touched. A field that does not fit sets a sticky error
+// and is dropped. finish() (or the destructor) stores the last partial
+// byte, padded with zero bits.
+//
+//   ex::bit_writer w(header);
+//   w.write(0x47, 8);
+//   w.write(pusi, 1);
+//   w.write(0, 1);
+//   w.write(pid, 13);
+template <bit_order Order = bit_order::msb_first> class basic_bit_writer {
+public:
+  basic_bit_writer(void *data, size_t size)
+      : m_begin(static_cast<uint8_t *>(data)), m_ptr(m_begin),
+        m_end(m_begin + size) {}
+
+  explicit basic_bit_writer(const shared_buffer &b)
+      : basic_bit_writer(b.data(), b.size()) {}
+
+  explicit basic_bit_writer(buffer &b) : basic_bit_writer(b.data(), b.size()) {}
+
+  basic_bit_writer(const basic_bit_writer &) = delete;
+  basic_bit_writer &operator=(const basic_bit_writer &) = delete;
+
+  ~basic_bit_writer() { finish(); }
+
+  // Writes the low n bits of v.
+  void write(uint64_t v, unsigned n) {
+    assert(n >= 1 && n <= 64);
+    if (n > remaining()) {
+      m_error = true;
+      return;
+    }
+    if (n > 32) {
+      if (Order == bit_order::msb_first) {
+        put(v >> 32 & mask(n - 32), n - 32);
+        put(v & mask(32), 32);
+      } else {
+        put(v & mask(32), 32);
+        put(v >> 32 & mask(n - 32), n - 32);
+      }
+    } else {
+      put(v & mask(n), n);
+    }
+  }
+
+  void write_signed(int64_t v, unsigned n) {
+    write(static_cast<uint64_t>(v), n);
+  }
+
+  // Pads with zero bits to the next byte boundary.
+  void align() {
+    if (auto pad = (8 - m_bits % 8) % 8)
+      write(0, pad);
+  }
+
+  // Stores the pending bits and returns the bytes written, counting a
+  // partial last byte. Writing may continue afterwards.
+  size_t finish() {
+    auto bytes = (m_bits + 7) / 8;
+    for (unsigned i = 0; i < bytes; ++i)
+      m_ptr[i] = Order == bit_order::msb_first
+                     ? static_cast<uint8_t>(m_acc >> (56 - i * 8))
+                     : static_cast<uint8_t>(m_acc >> (i * 8));
+    return static_cast<size_t>(m_ptr - m_begin) + bytes;
+  }
+
+  // In bits.
+  size_t position() const {
+    return static_cast<size_t>(m_ptr - m_begin) * 8 + m_bits;
+  }
+  size_t remaining() const { return size() - position(); }
+  size_t size() const { return static_cast<size_t>(m_end - m_begin) * 8; }
+
+  bool ok() const { return !m_error; }
+  bool failed() const { return m_error; }
+  void clear_error() { m_error = false; }
+
+private:
+  static uint64_t mask(unsigned n) { return ~uint64_t(0) >> (64 - n); }
+
+  // n <= 32, and the accumulator holds fewer than 32 bits.
+  void put(uint64_t v, unsigned n) {
+    if (Order == bit_order::msb_first)
+      m_acc |= v << (64 - m_bits - n);
+    else
+      m_acc |= v << m_bits;
+    m_bits += n;
+    if (m_bits >= 32) {
+      if (Order == bit_order::msb_first) {
+        buffer_write_be(m_ptr, static_cast<uint32_t>(m_acc >> 32));
+        m_acc <<= 32;
+      } else {
+        buffer_write_le(m_ptr, static_cast<uint32_t>(m_acc));
+        m_acc >>= 32;
+      }
+      m_ptr += 4;
+      m_bits -= 32;
+    }
+  }
+
+  uint8_t *m_begin;
+  uint8_t *m_ptr;
+  uint8_t *m_end;
+  uint64_t m_acc = 0;
+  unsigned m_bits = 0;
+  bool m_error = false;
+};
+
+using bit_writer = basic_bit_writer<>;
+using lsb_bit_writer = basic_bit_writer<bit_order::lsb_first>;
+} // namespace ex
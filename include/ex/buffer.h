@@ -1,6 +1,8 @@
 #pragma once
 
 #include "buffer_utils.h"
+#include "hexdump.h"
+#include "shared_buffer.h"
 #include <algorithm>
 #include <array>
 #include <cstddef>
@@ -13,6 +15,7 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <vector>
 
@@ -36,94 +39,242 @@ constexpr auto xxxx = has_value_type<std::string::value_type>;
 
 } // namespace _buffer_
 
+// Value-initialization (resize, sized construction) is turned into
+// default-initialization, so bytes are left uninitialized unless a value is
+// given explicitly.
+template <typename T, typename A = std::allocator<T>>
+class default_init_allocator : public A {
+  using a_t = std::allocator_traits<A>;
+
+public:
+  template <typename U> struct rebind {
+    using other =
+        default_init_allocator<U, typename a_t::template rebind_alloc<U>>;
+  };
+
+  using A::A;
+  default_init_allocator() = default;
+  default_init_allocator(const A &a) : A(a) {}
+
+  // Keeps the wrapper when A (e.g. a pmr allocator) picks the allocator for
+  // a copied container.
+  default_init_allocator select_on_container_copy_construction() const {
+    return a_t::select_on_container_copy_construction(
+        static_cast<const A &>(*this));
+  }
+
+  template <typename U>
+  void construct(U *ptr) noexcept(
+      std::is_nothrow_default_constructible_v<U>) {
+    ::new (static_cast<void *>(ptr)) U;
+  }
+
+  template <typename U, typename... Args>
+  void construct(U *ptr, Args &&...args) {
+    a_t::construct(static_cast<A &>(*this), ptr, std::forward<Args>(args)...);
+  }
+};
+
+namespace _buffer_ {
+template <typename> constexpr bool skips_init{};
+template <typename T, typename A>
+constexpr bool skips_init<default_init_allocator<T, A>> = true;
+} // namespace _buffer_
+
 using vector_u8 = std::vector<uint8_t>;
-class buffer : public vector_u8 {
+
+// Byte vector with the buffer API. uninitialized() and
+// resize_uninitialized() exist only with a default_init_allocator, which
+// can grow the vector without writing to it; with any other allocator,
+// such as ex::buffer's, every growth path but a range insert zero-fills.
+// The from() factories copy straight into new storage and never zero-fill.
+// The factories return Derived when one is given (see ex::buffer).
+template <typename Alloc = default_init_allocator<uint8_t>,
+          typename Derived = void>
+class basic_buffer : public std::vector<uint8_t, Alloc> {
+  using base = std::vector<uint8_t, Alloc>;
+  using self =
+      std::conditional_t<std::is_void_v<Derived>, basic_buffer, Derived>;
+  static constexpr bool skips_init = _buffer_::skips_init<Alloc>;
+
 public:
-  using vector_u8::vector_u8;
+  using typename base::allocator_type;
+  using typename base::size_type;
+  using base::base;
+  using base::begin;
+  using base::data;
+  using base::end;
+  using base::size;
+
+  basic_buffer() = default;
+  explicit basic_buffer(size_type size) : base(size, 0) {}
+  basic_buffer(size_type size, const allocator_type &alloc)
+      : base(size, 0, alloc) {}
+
+  template <bool B = skips_init, std::enable_if_t<B, bool> = true>
+  static self uninitialized(size_t size, const allocator_type &alloc = {}) {
+    self b(alloc);
+    b.resize_uninitialized(size);
+    return b;
+  }
 
-  static buffer from(std::initializer_list<uint8_t> t) {
+  using base::resize;
+  void resize(size_type size) { base::resize(size, 0); }
+
+  template <bool B = skips_init, std::enable_if_t<B, bool> = true>
+  void resize_uninitialized(size_type size) {
+    base::resize(size);
+  }
+
+  static self from(std::initializer_list<uint8_t> t) {
     return from(t.begin(), t.size());
   }
 
   template <typename Ptr, std::enable_if_t<std::is_pointer_v<Ptr>, bool> = true>
-  static buffer from(Ptr p, size_t size) {
-    buffer b(size);
-    std::copy(p, p + size, b.begin());
-    return b;
+  static self from(Ptr p, size_t size, const allocator_type &alloc = {}) {
+    return self(p, p + size, alloc);
   }
 
   template <typename Container,
             std::enable_if_t<_buffer_::is_iterable<Container>, bool> = true>
-  static buffer from(Container &&c) {
+  static self from(Container &&c) {
     using type = typename std::remove_reference<Container>::type::value_type;
     constexpr auto size = sizeof(type);
-    buffer b(c.size() * size);
-    std::copy(c.begin(), c.end(), b.begin());
-    return b;
+    if constexpr (size == 1) {
+      auto p = reinterpret_cast<const uint8_t *>(c.data());
+      return self(p, p + c.size());
+    } else {
+      // Each element is narrowed to a byte; the rest stays zero.
+      self b;
+      b.reserve(c.size() * size);
+      b.assign(c.begin(), c.end());
+      b.resize(c.size() * size);
+      return b;
+    }
   }
   template <typename Container,
             std::enable_if_t<_buffer_::is_iterable<Container>, bool> = true>
-  static buffer from(Container &&c, size_t byte_length) {
-    buffer b(byte_length);
-    auto p = (uint8_t *)(c.data());
-    std::copy(p, p + byte_length, b.data());
-    return b;
+  static self from(Container &&c, size_t byte_length) {
+    auto p = (const uint8_t *)(c.data());
+    return self(p, p + byte_length);
   }
 
-  template <typename Arr, size_t N> static buffer from(Arr (&a)[N]) {
-    if constexpr (std::is_same_v<Arr, const char>) {
-      auto size = N - 1;
-      buffer b(size);
-      memcpy(b.data(), a, size);
-      return b;
-    } else {
-      auto size = sizeof(Arr[N]);
-      buffer b(size);
-      memcpy(b.data(), a, size);
-      return b;
-    }
+  template <typename Arr, size_t N> static self from(Arr (&a)[N]) {
+    auto p = reinterpret_cast<const uint8_t *>(a);
+    if constexpr (std::is_same_v<Arr, const char>)
+      return self(p, p + N - 1);
+    else
+      return self(p, p + sizeof(Arr[N]));
   }
 
   template <typename Str,
             std::enable_if_t<std::is_same_v<const char *, Str>, bool> = true>
-  static buffer from(Str str) {
+  static self from(Str str) {
     return from(str, strlen(str));
   }
 
   template <typename Num,
             std::enable_if_t<std::is_arithmetic_v<Num>, bool> = true>
-  static buffer from(Num n) {
-    buffer b(sizeof(Num));
-    auto p = (uint8_t *)&n;
-    std::copy(p, p + sizeof(Num), b.data());
-    return b;
+  static self from(Num n) {
+    auto p = reinterpret_cast<const uint8_t *>(&n);
+    return self(p, p + sizeof(Num));
   }
 
-  static buffer from_hex(const std::string &str) {
-    auto len = str.size() / 2;
-    if (len % 2)
-      ++len;
-    buffer v(len);
-    v.write_hex(str);
-    return v;
+  static self from_hex(std::string_view str,
+                       const allocator_type &alloc = {}) {
+    auto digits = _buffer_utils_::hex_digits(str);
+    if constexpr (skips_init) {
+      auto v = uninitialized((digits + 1) / 2, alloc);
+      _buffer_utils_::write_hex(v.data(), str, digits);
+      return v;
+    } else {
+      self v(alloc);
+      _buffer_utils_::append_hex(v, str, digits);
+      return v;
+    }
   }
 
   template <typename T> void write_le(T v, size_t offset = 0) {
-    *reinterpret_cast<T *>(data() + offset) = v;
+    buffer_write_le(data() + offset, v);
   }
 
   template <typename T> void write_be(T v, size_t offset = 0) {
-    auto p = data() + offset;
-    *reinterpret_cast<T *>(p) = v;
-    std::reverse(p, p + sizeof(T));
+    buffer_write_be(data() + offset, v);
   }
 
-  template <typename T> T read_le(size_t offset = 0) {
-    return *reinterpret_cast<T *>(data() + offset);
+  template <typename T> T read_le(size_t offset = 0) const {
+    return buffer_read_le<T>(data() + offset);
   }
 
-  template <typename T> T read_be(size_t offset = 0) {
-    return buffer_switch_endian(read_le<T>(offset));
+  template <typename T> T read_be(size_t offset = 0) const {
+    return buffer_read_be<T>(data() + offset);
+  }
+
+  template <typename T>
+  void read_le_n(T *to, size_t count, size_t offset = 0) const {
+    buffer_read_le_n(data() + offset, to, count);
+  }
+
+  template <typename T>
+  void read_be_n(T *to, size_t count, size_t offset = 0) const {
+    buffer_read_be_n(data() + offset, to, count);
+  }
+
+  template <typename T>
+  void write_le_n(const T *from, size_t count, size_t offset = 0) {
+    buffer_write_le_n(data() + offset, from, count);
+  }
+
+  template <typename T>
+  void write_be_n(const T *from, size_t count, size_t offset = 0) {
+    buffer_write_be_n(data() + offset, from, count);
+  }
+
+  // Return the varint's length; read_varint returns 0 when it is truncated
+  // or malformed.
+  size_t read_varint(uint64_t &v, size_t offset = 0) const {
+    return offset < size()
+               ? buffer_read_varint(data() + offset, size() - offset, v)
+               : 0;
+  }
+
+  size_t write_varint(uint64_t v, size_t offset = 0) {
+    return buffer_write_varint(data() + offset, v);
+  }
+
+  static constexpr size_t npos = std::string::npos;
+
+  // Search from `offset` and return an index into the whole buffer, or npos.
+  size_t find(uint8_t byte, size_t offset = 0) const {
+    return offset > size()
+               ? npos
+               : found(buffer_find(data() + offset, size() - offset, byte),
+                       offset);
+  }
+
+  size_t find(std::string_view pattern, size_t offset = 0) const {
+    return offset > size() ? npos
+                           : found(buffer_find(data() + offset, size() - offset,
+                                               pattern.data(), pattern.size()),
+                                   offset);
+  }
+
+  size_t find_first_of(std::string_view set, size_t offset = 0) const {
+    return offset > size()
+               ? npos
+               : found(buffer_find_first_of(data() + offset, size() - offset,
+                                            set),
+                       offset);
+  }
+
+  // Views of the bytes between delimiters, valid while the buffer is not
+  // reallocated.
+  buffer_split split(uint8_t delimiter) const {
+    return buffer_split(shared_buffer(data(), size()), delimiter);
+  }
+
+  buffer_split split(std::string_view delimiter) const {
+    return buffer_split(shared_buffer(data(), size()), delimiter);
   }
 
   template <typename T> void fill(T *p, size_t offset, size_t size) {
@@ -145,80 +296,49 @@ public:
   template <typename T, size_t N> void fill(T (&t)[N]) { fill(t, 0, N); }
   void fill(const char *str) { fill(str, 0, strlen(str)); }
 
-  void write_hex(std::string hex, size_t offset = 0,
-                 bool skip_splitters_remove = false) {
-    if (!skip_splitters_remove)
-      hex.erase(std::remove_if(hex.begin(), hex.end(),
-                               [](char c) {
-                                 if (c < '0')
-                                   return true;
-                                 if (c <= '9')
-                                   return false;
-                                 if (c < 'A')
-                                   return true;
-                                 if (c <= 'F')
-                                   return false;
-                                 if (c < 'a')
-                                   return true;
-                                 if (c <= 'f')
-                                   return false;
-                                 return true;
-                               }),
-                hex.end());
-
-    auto hlen = hex.size();
-    auto len = hlen / 2;
-    auto odd = hlen % 2;
-    for (size_t i = 0; i < len; ++i) {
-      (*this)[offset + len - i - 1 + odd] = static_cast<uint8_t>(
-          std::stoi(hex.substr(hlen - 2 - i * 2, 2), nullptr, 16));
-    }
-    if (odd)
-      (*this)[offset] =
-          static_cast<uint8_t>(std::stoi(hex.substr(0, 1), nullptr, 16));
-  }
-
-  std::string read_hex(size_t offset, size_t size = 0,
-                       std::string splitter = "") {
-    if (!size)
-      size = this->size() - offset;
-    size_t splen = splitter.size();
-    size_t slen = size * 2 + (size - 1) * splen;
-    auto spblen = splen + 1;
-    char *c = new char[slen + 1];
-    const char *fmt = "%02x";
-    for (size_t i = 0; i < size; ++i) {
-      auto p = c + i * (2 + splen);
-      std::snprintf(p, 3, "%02x", at(i + offset));
-      std::snprintf(p + 2, spblen, "%s", splitter.c_str());
-    }
-    std::string s(c, slen);
-    delete[] c;
-    return s;
+  size_t write_hex(std::string_view hex, size_t offset = 0,
+                   bool skip_splitters_remove = false) {
+    return buffer_write_hex(data() + offset, hex, skip_splitters_remove);
   }
 
   std::string to_string() { return std::string(begin(), end()); }
+  std::string hexdump(const hexdump_options &opts = {}) const {
+    return buffer_hexdump(data(), size(), opts);
+  }
   auto to_hex_string(const std::string &splitter = "") const {
-    return buffer_read_hex((void *)data(), size(), splitter);
+    return buffer_read_hex(data(), size(), splitter);
   }
 
-  void write_hex(std::string hex, size_t offset = 0,
-                 bool skip_splitters_remove = false) const {
-    buffer_write_hex((void *)(data() + offset), hex, skip_splitters_remove);
+  size_t write_hex(std::string_view hex, size_t offset = 0,
+                   bool skip_splitters_remove = false) const {
+    return buffer_write_hex((void *)(data() + offset), hex,
+                            skip_splitters_remove);
   }
 
   std::string read_hex(size_t offset, size_t size = 0,
-                       std::string splitter = "") const {
-    return buffer_read_hex((void *)(data() + offset), size, splitter);
+                       const std::string &splitter = "") const {
+    if (!size)
+      size = this->size() - offset;
+    return buffer_read_hex(data() + offset, size, splitter);
+  }
+
+private:
+  static size_t found(size_t i, size_t offset) {
+    return i == npos ? npos : i + offset;
   }
 };
+
+// A class rather than an alias, so that it can be forward declared. Its
+// base is std::vector<uint8_t>, so resize() and emplace_back() zero-fill
+// and a buffer binds to std::vector<uint8_t> &.
+class buffer : public basic_buffer<std::allocator<uint8_t>, buffer> {
+public:
+  using basic_buffer::basic_buffer;
+};
 } // namespace ex
 
-inline std::ostream &operator<<(std::ostream &os, ex::buffer &buffer) {
-  os << "Buffer { ";
-  for (auto u : buffer) {
-    os << std::setfill('0') << std::setw(2) << std::hex << (int)u << ' ';
-  }
-  os << '}';
-  return os;
-}
\ No newline at end of file
+template <typename Alloc, typename Derived>
+std::ostream &operator<<(std::ostream &os,
+                         const ex::basic_buffer<Alloc, Derived> &buffer) {
+  return ex::buffer_hexdump(os, buffer.data(), buffer.size());
+}
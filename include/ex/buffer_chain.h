@@ -0,0 +1,218 @@
+#pragma once
+
+#include "buffer.h"
+#include "buffer_utils.h"
+#include "ref_buffer.h"
+#include "shared_buffer.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace ex {
+
+// A rope of segments. Appending, prepending and trimming never copy bytes;
+// reads that straddle segments are gathered on the stack. Segments added as
+// shared_buffer views are not owned and must outlive the chain.
+class buffer_chain {
+public:
+  buffer_chain() = default;
+
+  void append(buffer &&b) { push_back(ref_buffer(std::move(b))); }
+  void append(const ref_buffer &r) { push_back(r); }
+  void append(const shared_buffer &view) { push_back(as_segment(view)); }
+
+  void prepend(buffer &&b) { push_front(ref_buffer(std::move(b))); }
+  void prepend(const ref_buffer &r) { push_front(r); }
+  void prepend(const shared_buffer &view) { push_front(as_segment(view)); }
+
+  void append(buffer_chain &&c) {
+    if (&c == this)
+      return;
+    for (auto &s : c.m_segments)
+      push_back(std::move(s));
+    c.clear();
+  }
+
+  void trim_front(size_t n) {
+    check_range(0, n);
+    m_size -= n;
+    while (n) {
+      auto &s = m_segments.front();
+      if (n < s.size()) {
+        s = s.slice(n);
+        break;
+      }
+      n -= s.size();
+      m_segments.pop_front();
+    }
+  }
+
+  void trim_back(size_t n) {
+    check_range(0, n);
+    m_size -= n;
+    while (n) {
+      auto &s = m_segments.back();
+      if (n < s.size()) {
+        s = s.slice(0, s.size() - n);
+        break;
+      }
+      n -= s.size();
+      m_segments.pop_back();
+    }
+  }
+
+  void clear() {
+    m_segments.clear();
+    m_size = 0;
+  }
+
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+  size_t segment_count() const { return m_segments.size(); }
+  const std::deque<ref_buffer> &segments() const { return m_segments; }
+
+  uint8_t at(size_t i) const {
+    check_range(i, 1);
+    for (auto &s : m_segments) {
+      if (i < s.size())
+        return s.at(i);
+      i -= s.size();
+    }
+    return 0;
+  }
+
+  void copy_to(void *to, size_t offset, size_t size) const {
+    check_range(offset, size);
+    auto p = static_cast<uint8_t *>(to);
+    for (auto &s : m_segments) {
+      if (!size)
+        break;
+      if (offset >= s.size()) {
+        offset -= s.size();
+        continue;
+      }
+      auto n = std::min(size, s.size() - offset);
+      memcpy(p, s.data() + offset, n);
+      p += n;
+      size -= n;
+      offset = 0;
+    }
+  }
+
+  template <typename T,
+            std::enable_if_t<std::is_trivially_copyable_v<T>, bool> = true>
+  T read_le(size_t offset = 0) const {
+    check_range(offset, sizeof(T));
+    size_t base = 0;
+    auto &s = locate(offset, base);
+    if (offset + sizeof(T) <= s.size())
+      return buffer_read_le<T>(s.data() + offset);
+    uint8_t tmp[sizeof(T)];
+    copy_to(tmp, base + offset, sizeof(T));
+    return buffer_read_le<T>(tmp);
+  }
+
+  template <typename T,
+            std::enable_if_t<std::is_trivially_copyable_v<T>, bool> = true>
+  T read_be(size_t offset = 0) const {
+    return buffer_switch_endian(read_le<T>(offset));
+  }
+
+  std::string read_hex(size_t offset, size_t size = 0,
+                       const std::string &splitter = "") const {
+    if (!size)
+      size = m_size - offset;
+    check_range(offset, size);
+    if (!size)
+      return "";
+    auto splen = splitter.size();
+    auto stride = 2 + splen;
+    std::string str(size * 2 + (size - 1) * splen, '\0');
+    size_t done = 0;
+    for (auto &s : m_segments) {
+      if (done == size)
+        break;
+      if (offset >= s.size()) {
+        offset -= s.size();
+        continue;
+      }
+      auto n = std::min(size - done, s.size() - offset);
+      auto p = &str[done * stride];
+      _buffer_simd_::hex_encode(s.data() + offset, n, p, splitter.data(),
+                                splen);
+      done += n;
+      if (done != size)
+        memcpy(p + n * stride - splen, splitter.data(), splen);
+      offset = 0;
+    }
+    return str;
+  }
+
+  std::string to_hex_string(const std::string &splitter = "") const {
+    return read_hex(0, 0, splitter);
+  }
+
+  buffer to_buffer() const {
+    buffer b;
+    b.reserve(m_size);
+    for (auto &s : m_segments)
+      b.insert(b.end(), s.data(), s.data() + s.size());
+    return b;
+  }
+
+  // Merges all segments into one owned segment and returns it.
+  const ref_buffer &coalesce() {
+    if (m_segments.size() != 1 || !m_segments.front().owner()) {
+      auto merged = ref_buffer(to_buffer());
+      m_segments.clear();
+      m_segments.push_back(std::move(merged));
+    }
+    return m_segments.front();
+  }
+
+private:
+  static ref_buffer as_segment(const shared_buffer &view) {
+    return ref_buffer(nullptr, view.data(), view.size());
+  }
+
+  void push_back(ref_buffer r) {
+    if (!r.size())
+      return;
+    m_size += r.size();
+    m_segments.push_back(std::move(r));
+  }
+
+  void push_front(ref_buffer r) {
+    if (!r.size())
+      return;
+    m_size += r.size();
+    m_segments.push_front(std::move(r));
+  }
+
+  void check_range(size_t offset, size_t size) const {
+    if (offset > m_size || size > m_size - offset)
+      throw std::out_of_range("ex::buffer_chain");
+  }
+
+  // Returns the segment holding `offset`, rebases `offset` into it and sets
+  // `base` to the segment's position in the chain.
+  const ref_buffer &locate(size_t &offset, size_t &base) const {
+    for (auto &s : m_segments) {
+      if (offset < s.size())
+        return s;
+      offset -= s.size();
+      base += s.size();
+    }
+    throw std::out_of_range("ex::buffer_chain");
+  }
+
+  std::deque<ref_buffer> m_segments;
+  size_t m_size = 0;
+};
+} // namespace ex
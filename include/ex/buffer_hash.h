@@ -0,0 +1,174 @@
+#pragma once
+
+#include "buffer.h"
+#include "buffer_utils.h"
+#include "shared_buffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
+
+#if defined(_MSC_VER) && defined(_M_X64) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace ex {
+namespace _buffer_hash_ {
+static constexpr uint64_t secret[4] = {
+    0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull,
+    0x4d5a2da51de1aa47ull};
+
+// The 128-bit product of a and b, low half in a and high half in b.
+static inline void mum(uint64_t &a, uint64_t &b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = a;
+  r *= b;
+  a = static_cast<uint64_t>(r);
+  b = static_cast<uint64_t>(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64) && !defined(__clang__)
+  a = _umul128(a, b, &b);
+#else
+  uint64_t ha = a >> 32, hb = b >> 32, la = a & 0xffffffff, lb = b & 0xffffffff;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32), c = t < rl;
+  uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  a = lo;
+  b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t mix(uint64_t a, uint64_t b) {
+  mum(a, b);
+  return a ^ b;
+}
+
+static inline uint64_t r8(const uint8_t *p) {
+  return buffer_read_le<uint64_t>(p);
+}
+
+static inline uint64_t r4(const uint8_t *p) {
+  return buffer_read_le<uint32_t>(p);
+}
+} // namespace _buffer_hash_
+
+// 64-bit wyhash (final version 4). Not for untrusted keys where flooding
+// matters; reads little-endian, so hashes match across hosts.
+static inline uint64_t buffer_hash(const void *data, size_t size,
+                                   uint64_t seed = 0) {
+  using namespace _buffer_hash_;
+  auto p = static_cast<const uint8_t *>(data);
+  seed ^= mix(seed ^ secret[0], secret[1]);
+  uint64_t a, b;
+  if (size <= 16) {
+    if (size >= 4) {
+      auto mid = (size >> 3) << 2;
+      a = r4(p) << 32 | r4(p + mid);
+      b = r4(p + size - 4) << 32 | r4(p + size - 4 - mid);
+    } else if (size) {
+      a = uint64_t(p[0]) << 16 | uint64_t(p[size >> 1]) << 8 | p[size - 1];
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    auto i = size;
+    if (i > 48) {
+      auto see1 = seed, see2 = seed;
+      do {
+        seed = mix(r8(p) ^ secret[1], r8(p + 8) ^ seed);
+        see1 = mix(r8(p + 16) ^ secret[2], r8(p + 24) ^ see1);
+        see2 = mix(r8(p + 32) ^ secret[3], r8(p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    for (; i > 16; i -= 16, p += 16)
+      seed = mix(r8(p) ^ secret[1], r8(p + 8) ^ seed);
+    a = r8(p + i - 16);
+    b = r8(p + i - 8);
+  }
+  a ^= secret[1];
+  b ^= seed;
+  mum(a, b);
+  return mix(a ^ secret[0] ^ size, b ^ secret[1]);
+}
+
+static inline uint64_t buffer_hash(const shared_buffer &b, uint64_t seed = 0) {
+  return buffer_hash(b.data(), b.size(), seed);
+}
+
+template <typename Alloc, typename Derived>
+uint64_t buffer_hash(const basic_buffer<Alloc, Derived> &b, uint64_t seed = 0) {
+  return buffer_hash(b.data(), b.size(), seed);
+}
+
+// Hash and equality over the bytes of a buffer, a shared_buffer or a
+// string_view, so any of them can look up keys stored as another. Ordered
+// containers accept this since C++14:
+//
+//   std::map<ex::buffer, device, ex::buffer_less> devices;
+//   auto it = devices.find(ex::shared_buffer(frame.data() + 4, 6));
+//
+// Unordered ones need C++20 (__cpp_lib_generic_unordered_lookup) for
+// find() to use buffer_hasher/buffer_equal without a temporary key.
+struct buffer_hasher {
+  using is_transparent = void;
+
+  size_t operator()(const shared_buffer &b) const noexcept {
+    return static_cast<size_t>(buffer_hash(b.data(), b.size()));
+  }
+  template <typename Alloc, typename Derived>
+  size_t operator()(const basic_buffer<Alloc, Derived> &b) const noexcept {
+    return static_cast<size_t>(buffer_hash(b.data(), b.size()));
+  }
+  size_t operator()(std::string_view s) const noexcept {
+    return static_cast<size_t>(buffer_hash(s.data(), s.size()));
+  }
+};
+
+struct buffer_equal {
+  using is_transparent = void;
+
+  template <typename A, typename B>
+  bool operator()(const A &a, const B &b) const noexcept {
+    return a.size() == b.size() &&
+           (!a.size() || memcmp(a.data(), b.data(), a.size()) == 0);
+  }
+};
+
+// Lexicographic by byte, then by size, like std::string.
+struct buffer_less {
+  using is_transparent = void;
+
+  template <typename A, typename B>
+  bool operator()(const A &a, const B &b) const noexcept {
+    auto n = a.size() < b.size() ? a.size() : b.size();
+    auto c = n ? memcmp(a.data(), b.data(), n) : 0;
+    return c < 0 || (c == 0 && a.size() < b.size());
+  }
+};
+} // namespace ex
+
+namespace std {
+template <typename Alloc, typename Derived>
+struct hash<ex::basic_buffer<Alloc, Derived>> {
+  size_t operator()(const ex::basic_buffer<Alloc, Derived> &b) const noexcept {
+    return static_cast<size_t>(ex::buffer_hash(b.data(), b.size()));
+  }
+};
+
+template <> struct hash<ex::buffer> {
+  size_t operator()(const ex::buffer &b) const noexcept {
+    return static_cast<size_t>(ex::buffer_hash(b.data(), b.size()));
+  }
+};
+
+template <> struct hash<ex::shared_buffer> {
+  size_t operator()(const ex::shared_buffer &b) const noexcept {
+    return static_cast<size_t>(ex::buffer_hash(b.data(), b.size()));
+  }
+};
+} // namespace std
@@ -0,0 +1,355 @@
+#pragma once
+
+#include "buffer.h"
+#include "shared_buffer.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ex {
+namespace _buffer_pool_ {
+// Dmitry Vyukov's bounded MPMC queue: one CAS per push or pop, no locks.
+template <typename T> class mpmc_queue {
+public:
+  explicit mpmc_queue(size_t capacity) {
+    size_t n = 2;
+    while (n < capacity)
+      n <<= 1;
+    m_mask = n - 1;
+    m_cells.reset(new cell[n]);
+    for (size_t i = 0; i < n; ++i)
+      m_cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  bool push(T v) {
+    auto pos = m_tail.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &c = m_cells[pos & m_mask];
+      auto seq = c.seq.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (m_tail.compare_exchange_weak(pos, pos + 1,
+                                         std::memory_order_relaxed)) {
+          c.value = v;
+          c.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = m_tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool pop(T &v) {
+    auto pos = m_head.load(std::memory_order_relaxed);
+    for (;;) {
+      auto &c = m_cells[pos & m_mask];
+      auto seq = c.seq.load(std::memory_order_acquire);
+      auto diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (m_head.compare_exchange_weak(pos, pos + 1,
+                                         std::memory_order_relaxed)) {
+          v = c.value;
+          c.seq.store(pos + m_mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = m_head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+private:
+  struct cell {
+    std::atomic<size_t> seq;
+    T value;
+  };
+
+  std::unique_ptr<cell[]> m_cells;
+  size_t m_mask;
+  alignas(64) std::atomic<size_t> m_tail{0};
+  alignas(64) std::atomic<size_t> m_head{0};
+};
+
+// Shared by a pool, its buffers and the thread caches that hold them. Each
+// live buffer and each cache holds a reference, so handles may outlive the
+// pool.
+struct state {
+  state(size_t buffer_size, size_t capacity)
+      : buffer_size(buffer_size), free(capacity) {}
+
+  void retain() { refs.fetch_add(1, std::memory_order_relaxed); }
+
+  void release() {
+    if (refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      delete this;
+  }
+
+  buffer *make() {
+    misses.fetch_add(1, std::memory_order_relaxed);
+    auto n = allocated.fetch_add(1, std::memory_order_relaxed) + 1;
+    auto peak = high_water.load(std::memory_order_relaxed);
+    while (n > peak && !high_water.compare_exchange_weak(
+                           peak, n, std::memory_order_relaxed)) {
+    }
+    retain();
+    return new buffer(buffer_size);
+  }
+
+  // May free the state; do not touch it afterwards.
+  void destroy(buffer *b) {
+    delete b;
+    allocated.fetch_sub(1, std::memory_order_relaxed);
+    release();
+  }
+
+  void drain() {
+    buffer *b;
+    while (free.pop(b))
+      destroy(b);
+  }
+
+  void put(buffer *b) {
+    if (closed.load() || !free.push(b))
+      return destroy(b);
+    // The pool may have closed and drained the queue since the check.
+    if (closed.load())
+      drain();
+  }
+
+  const size_t buffer_size;
+  mpmc_queue<buffer *> free;
+  std::atomic<bool> closed{false};
+  std::atomic<size_t> refs{1};
+  alignas(64) std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+  std::atomic<size_t> allocated{0};
+  std::atomic<size_t> high_water{0};
+};
+
+// Per-thread stack of free buffers for one pool. It moves half of its
+// capacity to or from the shared queue at a time and publishes its hit
+// count when it does so.
+struct cache {
+  static constexpr size_t capacity = 32;
+
+  explicit cache(state *s) : owner(s) { owner->retain(); }
+
+  ~cache() {
+    flush_hits();
+    while (count)
+      owner->put(items[--count]);
+    owner->release();
+  }
+
+  void flush_hits() {
+    owner->hits.fetch_add(hits, std::memory_order_relaxed);
+    hits = 0;
+  }
+
+  state *owner;
+  buffer *items[capacity];
+  size_t count = 0;
+  uint64_t hits = 0;
+};
+
+// Bumped by each pool's destructor; a thread that sees it change frees the
+// caches of closed pools on its next acquire or release.
+inline std::atomic<uint64_t> &closed_pools() {
+  static std::atomic<uint64_t> n{0};
+  return n;
+}
+
+struct thread_caches {
+  void sweep() {
+    auto now = closed_pools().load(std::memory_order_acquire);
+    if (now == epoch)
+      return;
+    epoch = now;
+    for (size_t i = 0; i < caches.size();) {
+      if (caches[i]->owner->closed.load(std::memory_order_acquire)) {
+        caches[i] = std::move(caches.back());
+        caches.pop_back();
+      } else {
+        ++i;
+      }
+    }
+  }
+
+  std::vector<std::unique_ptr<cache>> caches;
+  uint64_t epoch = 0;
+};
+
+inline thread_caches &this_thread_caches() {
+  thread_local thread_caches t;
+  return t;
+}
+
+inline cache &thread_cache(state *s) {
+  auto &t = this_thread_caches();
+  t.sweep();
+  for (auto &c : t.caches)
+    if (c->owner == s)
+      return *c;
+  t.caches.push_back(std::make_unique<cache>(s));
+  return *t.caches.back();
+}
+} // namespace _buffer_pool_
+
+struct buffer_pool_stats {
+  // Acquisitions served from a recycled buffer. Other threads publish
+  // their counts when their cache refills, spills or is destroyed, so this
+  // lags while they run.
+  uint64_t hits;
+  // Acquisitions that allocated a new buffer.
+  uint64_t misses;
+  // Buffers alive now: in use, cached or queued.
+  size_t allocated;
+  // Peak of `allocated`.
+  size_t high_water;
+};
+
+// An ex::buffer on loan from a buffer_pool; it goes back to the pool on
+// destruction, or is freed if the pool is gone.
+class pooled_buffer {
+public:
+  pooled_buffer() = default;
+
+  pooled_buffer(pooled_buffer &&o) noexcept
+      : m_state(std::exchange(o.m_state, nullptr)),
+        m_buffer(std::exchange(o.m_buffer, nullptr)) {}
+
+  pooled_buffer &operator=(pooled_buffer &&o) noexcept {
+    if (this != &o) {
+      reset();
+      m_state = std::exchange(o.m_state, nullptr);
+      m_buffer = std::exchange(o.m_buffer, nullptr);
+    }
+    return *this;
+  }
+
+  pooled_buffer(const pooled_buffer &) = delete;
+  pooled_buffer &operator=(const pooled_buffer &) = delete;
+
+  ~pooled_buffer() { reset(); }
+
+  buffer &operator*() const { return *m_buffer; }
+  buffer *operator->() const { return m_buffer; }
+  buffer *get() const { return m_buffer; }
+  explicit operator bool() const { return m_buffer != nullptr; }
+
+  shared_buffer view() const {
+    return shared_buffer(m_buffer->data(), m_buffer->size());
+  }
+
+  // Takes the buffer out of the pool for good; an empty handle gives an
+  // empty buffer.
+  buffer detach() {
+    if (!m_buffer)
+      return buffer();
+    auto b = std::move(*m_buffer);
+    m_state->destroy(std::exchange(m_buffer, nullptr));
+    m_state = nullptr;
+    return b;
+  }
+
+  void reset() {
+    if (!m_buffer)
+      return;
+    if (m_state->closed.load(std::memory_order_acquire)) {
+      m_state->destroy(m_buffer);
+    } else {
+      auto &c = _buffer_pool_::thread_cache(m_state);
+      if (c.count == c.capacity) {
+        c.flush_hits();
+        while (c.count > c.capacity / 2)
+          m_state->put(c.items[--c.count]);
+      }
+      c.items[c.count++] = m_buffer;
+    }
+    m_buffer = nullptr;
+    m_state = nullptr;
+  }
+
+private:
+  friend class buffer_pool;
+
+  pooled_buffer(_buffer_pool_::state *s, buffer *b)
+      : m_state(s), m_buffer(b) {}
+
+  _buffer_pool_::state *m_state = nullptr;
+  buffer *m_buffer = nullptr;
+};
+
+// Recycles fixed-size buffers. Each thread keeps a small cache of free
+// buffers, backed by a lock-free queue shared by all threads, so the
+// steady state does not call malloc.
+//
+//   ex::buffer_pool pool(16 << 10);
+//   auto rx = pool.acquire();
+//   auto n = recv(fd, rx->data(), rx->size(), 0);
+class buffer_pool {
+public:
+  // `capacity` bounds the buffers kept in the shared queue; extra returns
+  // are freed.
+  explicit buffer_pool(size_t buffer_size, size_t capacity = 1024)
+      : m_state(new _buffer_pool_::state(buffer_size, capacity)) {}
+
+  buffer_pool(const buffer_pool &) = delete;
+  buffer_pool &operator=(const buffer_pool &) = delete;
+
+  // Frees the queued buffers and this thread's cached ones; other threads
+  // free theirs on their next use of any pool. Buffers still on loan are
+  // freed when their handles are released.
+  ~buffer_pool() {
+    m_state->closed.store(true);
+    m_state->drain();
+    _buffer_pool_::closed_pools().fetch_add(1, std::memory_order_release);
+    _buffer_pool_::this_thread_caches().sweep();
+    m_state->release();
+  }
+
+  // The buffer's size is buffer_size(). A new buffer is zeroed once, when
+  // it is allocated; a recycled one keeps whatever it last held.
+  pooled_buffer acquire() {
+    auto s = m_state;
+    auto &c = _buffer_pool_::thread_cache(s);
+    if (!c.count) {
+      c.flush_hits();
+      buffer *b;
+      while (c.count < c.capacity / 2 && s->free.pop(b))
+        c.items[c.count++] = b;
+    }
+    buffer *b;
+    if (c.count) {
+      b = c.items[--c.count];
+      ++c.hits;
+      if (b->size() != s->buffer_size)
+        b->resize(s->buffer_size);
+    } else {
+      b = s->make();
+    }
+    return pooled_buffer(s, b);
+  }
+
+  size_t buffer_size() const { return m_state->buffer_size; }
+
+  buffer_pool_stats stats() const {
+    _buffer_pool_::thread_cache(m_state).flush_hits();
+    return {m_state->hits.load(std::memory_order_relaxed),
+            m_state->misses.load(std::memory_order_relaxed),
+            m_state->allocated.load(std::memory_order_relaxed),
+            m_state->high_water.load(std::memory_order_relaxed)};
+  }
+
+private:
+  _buffer_pool_::state *m_state;
+};
+} // namespace ex
@@ -0,0 +1,952 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) ||            \
+    defined(_M_IX86)
+#define EX_BUFFER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define EX_BUFFER_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(EX_BUFFER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define EX_BUFFER_TARGET(t) __attribute__((target(t)))
+#define EX_BUFFER_DISPATCH 1
+#else
+#define EX_BUFFER_TARGET(t)
+#endif
+
+namespace ex {
+namespace _buffer_simd_ {
+
+struct cpu_features {
+  bool sse2 = false;
+  bool ssse3 = false;
+  bool sse42 = false;
+  bool pclmul = false;
+  bool avx2 = false;
+  bool neon = false;
+};
+
+static inline cpu_features detect_cpu_features() {
+  cpu_features f;
+#if defined(EX_BUFFER_DISPATCH)
+  __builtin_cpu_init();
+  f.sse2 = __builtin_cpu_supports("sse2");
+  f.ssse3 = __builtin_cpu_supports("ssse3");
+  f.sse42 = __builtin_cpu_supports("sse4.2");
+  f.pclmul = __builtin_cpu_supports("pclmul");
+  f.avx2 = __builtin_cpu_supports("avx2");
+#elif defined(EX_BUFFER_X86)
+  f.sse2 = true;
+#elif defined(EX_BUFFER_NEON)
+  f.neon = true;
+#endif
+  return f;
+}
+
+static inline const cpu_features &cpu() {
+  static const cpu_features f = detect_cpu_features();
+  return f;
+}
+
+struct hex_pair_table {
+  char v[512];
+  constexpr hex_pair_table() : v() {
+    constexpr char digits[] = "0123456789abcdef";
+    for (int i = 0; i < 256; ++i) {
+      v[i * 2] = digits[i >> 4];
+      v[i * 2 + 1] = digits[i & 0xf];
+    }
+  }
+};
+
+inline constexpr hex_pair_table hex_pairs{};
+
+using hex_encode_fn = void (*)(const uint8_t *, size_t, char *);
+
+static inline void hex_encode_scalar(const uint8_t *from, size_t size,
+                                     char *to) {
+  for (size_t i = 0; i < size; ++i)
+    memcpy(to + i * 2, hex_pairs.v + from[i] * 2, 2);
+}
+
+#if defined(EX_BUFFER_X86)
+static inline __m128i hex_nibbles_sse2(__m128i n) {
+  auto gt9 = _mm_cmpgt_epi8(n, _mm_set1_epi8(9));
+  auto v = _mm_add_epi8(n, _mm_set1_epi8('0'));
+  return _mm_add_epi8(v, _mm_and_si128(gt9, _mm_set1_epi8('a' - '0' - 10)));
+}
+
+static inline void hex_encode_sse2(const uint8_t *from, size_t size,
+                                   char *to) {
+  auto mask = _mm_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + i));
+    auto hi = hex_nibbles_sse2(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+    auto lo = hex_nibbles_sse2(_mm_and_si128(v, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(to + i * 2),
+                     _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(to + i * 2 + 16),
+                     _mm_unpackhi_epi8(hi, lo));
+  }
+  hex_encode_scalar(from + i, size - i, to + i * 2);
+}
+#endif
+
+#if defined(EX_BUFFER_DISPATCH)
+EX_BUFFER_TARGET("avx2")
+static inline __m256i hex_nibbles_avx2(__m256i n) {
+  auto gt9 = _mm256_cmpgt_epi8(n, _mm256_set1_epi8(9));
+  auto v = _mm256_add_epi8(n, _mm256_set1_epi8('0'));
+  return _mm256_add_epi8(
+      v, _mm256_and_si256(gt9, _mm256_set1_epi8('a' - '0' - 10)));
+}
+
+EX_BUFFER_TARGET("avx2")
+static inline void hex_encode_avx2(const uint8_t *from, size_t size,
+                                   char *to) {
+  auto mask = _mm256_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(from + i));
+    auto hi =
+        hex_nibbles_avx2(_mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+    auto lo = hex_nibbles_avx2(_mm256_and_si256(v, mask));
+    auto a = _mm256_unpacklo_epi8(hi, lo);
+    auto b = _mm256_unpackhi_epi8(hi, lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(to + i * 2),
+                        _mm256_permute2x128_si256(a, b, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(to + i * 2 + 32),
+                        _mm256_permute2x128_si256(a, b, 0x31));
+  }
+  hex_encode_sse2(from + i, size - i, to + i * 2);
+}
+#endif
+
+#if defined(EX_BUFFER_NEON)
+static inline void hex_encode_neon(const uint8_t *from, size_t size,
+                                   char *to) {
+  static const uint8_t digits[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                     '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+  auto table = vld1q_u8(digits);
+  auto mask = vdupq_n_u8(0x0f);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    auto v = vld1q_u8(from + i);
+    uint8x16x2_t out;
+    out.val[0] = vqtbl1q_u8(table, vshrq_n_u8(v, 4));
+    out.val[1] = vqtbl1q_u8(table, vandq_u8(v, mask));
+    vst2q_u8(reinterpret_cast<uint8_t *>(to + i * 2), out);
+  }
+  hex_encode_scalar(from + i, size - i, to + i * 2);
+}
+#endif
+
+static inline hex_encode_fn select_hex_encoder() {
+#if defined(EX_BUFFER_DISPATCH)
+  if (cpu().avx2)
+    return hex_encode_avx2;
+#endif
+#if defined(EX_BUFFER_X86)
+  return hex_encode_sse2;
+#elif defined(EX_BUFFER_NEON)
+  return hex_encode_neon;
+#else
+  return hex_encode_scalar;
+#endif
+}
+
+static inline hex_encode_fn hex_encoder() {
+  static const hex_encode_fn fn = select_hex_encoder();
+  return fn;
+}
+
+static inline void hex_encode(const uint8_t *from, size_t size, char *to) {
+  hex_encoder()(from, size, to);
+}
+
+// Encodes with a one-character splitter after every byte. Kernels stop
+// before the last block so the trailing splitter they write stays valid;
+// they return the number of bytes encoded.
+using hex_encode_split1_fn = size_t (*)(const uint8_t *, size_t, char *,
+                                        char);
+
+static inline size_t hex_encode_split1_none(const uint8_t *, size_t, char *,
+                                            char) {
+  return 0;
+}
+
+#if defined(EX_BUFFER_DISPATCH)
+struct hex_split1_shuffle {
+  uint8_t lo[3][16];
+  uint8_t hi[3][16];
+  uint8_t sep[3][16];
+  constexpr hex_split1_shuffle() : lo(), hi(), sep() {
+    for (int k = 0; k < 3; ++k) {
+      for (int j = 0; j < 16; ++j) {
+        auto g = k * 16 + j;
+        auto r = g % 3;
+        auto h = g / 3 * 2 + r;
+        lo[k][j] = r == 2 || h >= 16 ? 0x80 : static_cast<uint8_t>(h);
+        hi[k][j] = r == 2 || h < 16 ? 0x80 : static_cast<uint8_t>(h - 16);
+        sep[k][j] = r == 2 ? 0xff : 0;
+      }
+    }
+  }
+};
+
+inline constexpr hex_split1_shuffle hex_split1_shuffles{};
+
+EX_BUFFER_TARGET("ssse3")
+static inline size_t hex_encode_split1_ssse3(const uint8_t *from, size_t size,
+                                             char *to, char splitter) {
+  auto mask = _mm_set1_epi8(0x0f);
+  auto sep = _mm_set1_epi8(splitter);
+  __m128i lo[3], hi[3], seps[3];
+  for (int k = 0; k < 3; ++k) {
+    auto &t = hex_split1_shuffles;
+    lo[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t.lo[k]));
+    hi[k] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(t.hi[k]));
+    seps[k] = _mm_and_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(t.sep[k])), sep);
+  }
+  size_t i = 0;
+  for (; i + 16 < size; i += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + i));
+    auto h = hex_nibbles_sse2(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+    auto l = hex_nibbles_sse2(_mm_and_si128(v, mask));
+    auto a = _mm_unpacklo_epi8(h, l);
+    auto b = _mm_unpackhi_epi8(h, l);
+    for (int k = 0; k < 3; ++k) {
+      auto out = _mm_or_si128(_mm_shuffle_epi8(a, lo[k]),
+                              _mm_shuffle_epi8(b, hi[k]));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(to + i * 3 + k * 16),
+                       _mm_or_si128(out, seps[k]));
+    }
+  }
+  return i;
+}
+#endif
+
+#if defined(EX_BUFFER_NEON)
+static inline size_t hex_encode_split1_neon(const uint8_t *from, size_t size,
+                                            char *to, char splitter) {
+  static const uint8_t digits[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                     '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+  auto table = vld1q_u8(digits);
+  auto mask = vdupq_n_u8(0x0f);
+  uint8x16x3_t out;
+  out.val[2] = vdupq_n_u8(static_cast<uint8_t>(splitter));
+  size_t i = 0;
+  for (; i + 16 < size; i += 16) {
+    auto v = vld1q_u8(from + i);
+    out.val[0] = vqtbl1q_u8(table, vshrq_n_u8(v, 4));
+    out.val[1] = vqtbl1q_u8(table, vandq_u8(v, mask));
+    vst3q_u8(reinterpret_cast<uint8_t *>(to + i * 3), out);
+  }
+  return i;
+}
+#endif
+
+static inline hex_encode_split1_fn select_hex_encoder_split1() {
+#if defined(EX_BUFFER_DISPATCH)
+  if (cpu().ssse3)
+    return hex_encode_split1_ssse3;
+#elif defined(EX_BUFFER_NEON)
+  return hex_encode_split1_neon;
+#endif
+  return hex_encode_split1_none;
+}
+
+static inline size_t hex_encode_split1(const uint8_t *from, size_t size,
+                                       char *to, char splitter) {
+  static const hex_encode_split1_fn fn = select_hex_encoder_split1();
+  return fn(from, size, to, splitter);
+}
+
+static inline void hex_encode(const uint8_t *from, size_t size, char *to,
+                              const char *splitter, size_t splen) {
+  if (!splen)
+    return hex_encode(from, size, to);
+  constexpr size_t chunk = 256;
+  char pairs[chunk * 2];
+  auto stride = 2 + splen;
+  size_t i = splen == 1 ? hex_encode_split1(from, size, to, *splitter) : 0;
+  while (i < size) {
+    auto n = size - i < chunk ? size - i : chunk;
+    hex_encode(from + i, n, pairs);
+    for (size_t j = 0; j < n; ++j, ++i) {
+      auto p = to + i * stride;
+      memcpy(p, pairs + j * 2, 2);
+      if (i + 1 != size)
+        memcpy(p + 2, splitter, splen);
+    }
+  }
+}
+
+static constexpr size_t npos = static_cast<size_t>(-1);
+
+static inline unsigned ctz32(uint32_t v) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long i;
+  _BitScanForward(&i, v);
+  return static_cast<unsigned>(i);
+#else
+  return static_cast<unsigned>(__builtin_ctz(v));
+#endif
+}
+
+struct hex_value_table {
+  uint8_t v[256];
+  constexpr hex_value_table() : v() {
+    for (int i = 0; i < 256; ++i)
+      v[i] = 0xff;
+    for (int i = 0; i < 10; ++i)
+      v['0' + i] = static_cast<uint8_t>(i);
+    for (int i = 0; i < 6; ++i) {
+      v['a' + i] = static_cast<uint8_t>(10 + i);
+      v['A' + i] = static_cast<uint8_t>(10 + i);
+    }
+  }
+};
+
+inline constexpr hex_value_table hex_values{};
+
+static inline uint8_t hex_value(char c) {
+  return hex_values.v[static_cast<uint8_t>(c)];
+}
+
+static inline size_t hex_count_digits_scalar(const char *from, size_t size) {
+  size_t n = 0;
+  for (size_t i = 0; i < size; ++i)
+    n += hex_value(from[i]) != 0xff;
+  return n;
+}
+
+// Decodes `pairs` two-digit pairs. Returns the index of the first non-hex
+// character or npos.
+static inline size_t hex_decode_pairs_scalar(const char *from, size_t pairs,
+                                             uint8_t *to) {
+  for (size_t i = 0; i < pairs; ++i) {
+    auto h = hex_value(from[i * 2]);
+    auto l = hex_value(from[i * 2 + 1]);
+    if ((h | l) == 0xff)
+      return h == 0xff ? i * 2 : i * 2 + 1;
+    to[i] = static_cast<uint8_t>(h << 4 | l);
+  }
+  return npos;
+}
+
+#if defined(EX_BUFFER_X86)
+static inline __m128i hex_values_sse2(__m128i c, __m128i &valid) {
+  auto digit = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+  auto is_digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+  auto alpha = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)),
+                            _mm_set1_epi8('a'));
+  auto is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+  valid = _mm_or_si128(is_digit, is_alpha);
+  return _mm_or_si128(
+      _mm_and_si128(is_digit, digit),
+      _mm_and_si128(is_alpha, _mm_add_epi8(alpha, _mm_set1_epi8(10))));
+}
+
+static inline __m128i hex_join_sse2(__m128i v) {
+  auto hi = _mm_slli_epi16(_mm_and_si128(v, _mm_set1_epi16(0x00ff)), 4);
+  return _mm_or_si128(hi, _mm_srli_epi16(v, 8));
+}
+
+static inline size_t hex_decode_pairs_sse2(const char *from, size_t pairs,
+                                           uint8_t *to) {
+  size_t i = 0;
+  for (; i + 16 <= pairs; i += 16) {
+    __m128i va, vb;
+    auto a = hex_values_sse2(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + i * 2)), va);
+    auto b = hex_values_sse2(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + i * 2 + 16)),
+        vb);
+    auto mask = static_cast<uint32_t>(_mm_movemask_epi8(va)) |
+                static_cast<uint32_t>(_mm_movemask_epi8(vb)) << 16;
+    if (mask != 0xffffffffu)
+      return i * 2 + ctz32(~mask);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(to + i),
+                     _mm_packus_epi16(hex_join_sse2(a), hex_join_sse2(b)));
+  }
+  auto r = hex_decode_pairs_scalar(from + i * 2, pairs - i, to + i);
+  return r == npos ? npos : r + i * 2;
+}
+
+static inline size_t hex_count_digits_sse2(const char *from, size_t size) {
+  size_t n = 0;
+  size_t i = 0;
+  while (i + 16 <= size) {
+    // Per-lane counters; flushed before they can overflow.
+    auto acc = _mm_setzero_si128();
+    for (int k = 0; k < 255 && i + 16 <= size; ++k, i += 16) {
+      __m128i valid;
+      hex_values_sse2(
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + i)), valid);
+      acc = _mm_sub_epi8(acc, valid);
+    }
+    auto sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+    n += static_cast<size_t>(_mm_cvtsi128_si32(sums)) +
+         static_cast<size_t>(_mm_extract_epi16(sums, 4));
+  }
+  return n + hex_count_digits_scalar(from + i, size - i);
+}
+#endif
+
+#if defined(EX_BUFFER_NEON)
+static inline uint8x16_t hex_values_neon(uint8x16_t c, uint8x16_t &valid) {
+  auto digit = vsubq_u8(c, vdupq_n_u8('0'));
+  auto is_digit = vcleq_u8(digit, vdupq_n_u8(9));
+  auto alpha = vsubq_u8(vorrq_u8(c, vdupq_n_u8(0x20)), vdupq_n_u8('a'));
+  auto is_alpha = vcleq_u8(alpha, vdupq_n_u8(5));
+  valid = vorrq_u8(is_digit, is_alpha);
+  return vorrq_u8(vandq_u8(is_digit, digit),
+                  vandq_u8(is_alpha, vaddq_u8(alpha, vdupq_n_u8(10))));
+}
+
+static inline size_t hex_decode_pairs_neon(const char *from, size_t pairs,
+                                           uint8_t *to) {
+  size_t i = 0;
+  for (; i + 16 <= pairs; i += 16) {
+    auto c = vld2q_u8(reinterpret_cast<const uint8_t *>(from + i * 2));
+    uint8x16_t vh, vl;
+    auto h = hex_values_neon(c.val[0], vh);
+    auto l = hex_values_neon(c.val[1], vl);
+    if (vminvq_u8(vandq_u8(vh, vl)) != 0xff)
+      break;
+    vst1q_u8(to + i, vorrq_u8(vshlq_n_u8(h, 4), l));
+  }
+  auto r = hex_decode_pairs_scalar(from + i * 2, pairs - i, to + i);
+  return r == npos ? npos : r + i * 2;
+}
+
+static inline size_t hex_count_digits_neon(const char *from, size_t size) {
+  size_t n = 0;
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    uint8x16_t valid;
+    hex_values_neon(vld1q_u8(reinterpret_cast<const uint8_t *>(from + i)),
+                    valid);
+    n += vaddvq_u8(vandq_u8(valid, vdupq_n_u8(1)));
+  }
+  return n + hex_count_digits_scalar(from + i, size - i);
+}
+#endif
+
+static inline size_t hex_count_digits(const char *from, size_t size) {
+#if defined(EX_BUFFER_X86)
+  return hex_count_digits_sse2(from, size);
+#elif defined(EX_BUFFER_NEON)
+  return hex_count_digits_neon(from, size);
+#else
+  return hex_count_digits_scalar(from, size);
+#endif
+}
+
+static inline size_t hex_decode_pairs(const char *from, size_t pairs,
+                                      uint8_t *to) {
+#if defined(EX_BUFFER_X86)
+  return hex_decode_pairs_sse2(from, pairs, to);
+#elif defined(EX_BUFFER_NEON)
+  return hex_decode_pairs_neon(from, pairs, to);
+#else
+  return hex_decode_pairs_scalar(from, pairs, to);
+#endif
+}
+
+// Decodes a string made only of hex digits. An odd leading digit becomes
+// the low nibble of the first byte.
+static inline size_t hex_decode(const char *from, size_t size, uint8_t *to) {
+  auto odd = size % 2;
+  if (odd) {
+    auto v = hex_value(*from);
+    if (v == 0xff)
+      return 0;
+    *to = v;
+  }
+  auto r = hex_decode_pairs(from + odd, size / 2, to + odd);
+  return r == npos ? npos : r + odd;
+}
+
+// Decodes `digits` hex digits from a string that may contain splitters.
+static inline void hex_decode_split(const char *from, size_t size,
+                                    size_t digits, uint8_t *to) {
+  bool low = digits % 2;
+  uint8_t acc = 0;
+  for (size_t i = 0; i < size; ++i) {
+    auto v = hex_value(from[i]);
+    if (v == 0xff)
+      continue;
+    if (low) {
+      *to++ = static_cast<uint8_t>(acc << 4 | v);
+    } else {
+      acc = v;
+    }
+    low = !low;
+  }
+}
+
+// Byte-swaps `count` elements of W bytes. Returns how many elements were
+// converted; the caller finishes the tail.
+using bswap_fn = size_t (*)(const uint8_t *, uint8_t *, size_t);
+
+template <size_t W> static inline size_t bswap_none(const uint8_t *, uint8_t *,
+                                                    size_t) {
+  return 0;
+}
+
+template <size_t W> struct bswap_shuffle {
+  uint8_t v[32];
+  constexpr bswap_shuffle() : v() {
+    for (size_t i = 0; i < 32; ++i) {
+      auto j = i % 16;
+      v[i] = static_cast<uint8_t>(j / W * W + (W - 1 - j % W));
+    }
+  }
+};
+
+template <size_t W> inline constexpr bswap_shuffle<W> bswap_shuffles{};
+
+#if defined(EX_BUFFER_DISPATCH)
+template <size_t W>
+EX_BUFFER_TARGET("ssse3")
+static inline size_t bswap_ssse3(const uint8_t *from, uint8_t *to,
+                                 size_t count) {
+  auto mask =
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(bswap_shuffles<W>.v));
+  auto n = count * W / 16 * 16;
+  for (size_t i = 0; i < n; i += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(to + i),
+                     _mm_shuffle_epi8(v, mask));
+  }
+  return n / W;
+}
+
+template <size_t W>
+EX_BUFFER_TARGET("avx2")
+static inline size_t bswap_avx2(const uint8_t *from, uint8_t *to,
+                                size_t count) {
+  auto mask = _mm256_loadu_si256(
+      reinterpret_cast<const __m256i *>(bswap_shuffles<W>.v));
+  auto n = count * W / 32 * 32;
+  for (size_t i = 0; i < n; i += 32) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(from + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(to + i),
+                        _mm256_shuffle_epi8(v, mask));
+  }
+  auto done = n / W;
+  return done + bswap_ssse3<W>(from + n, to + n, count - done);
+}
+#endif
+
+#if defined(EX_BUFFER_NEON)
+template <size_t W>
+static inline size_t bswap_neon(const uint8_t *from, uint8_t *to,
+                                size_t count) {
+  auto n = count * W / 16 * 16;
+  for (size_t i = 0; i < n; i += 16) {
+    auto v = vld1q_u8(from + i);
+    if constexpr (W == 2)
+      v = vrev16q_u8(v);
+    else if constexpr (W == 4)
+      v = vrev32q_u8(v);
+    else
+      v = vrev64q_u8(v);
+    vst1q_u8(to + i, v);
+  }
+  return n / W;
+}
+#endif
+
+template <size_t W> static inline bswap_fn select_bswap() {
+#if defined(EX_BUFFER_DISPATCH)
+  if (cpu().avx2)
+    return bswap_avx2<W>;
+  if (cpu().ssse3)
+    return bswap_ssse3<W>;
+#elif defined(EX_BUFFER_NEON)
+  return bswap_neon<W>;
+#endif
+  return bswap_none<W>;
+}
+
+template <size_t W>
+static inline size_t bswap_n(const uint8_t *from, uint8_t *to, size_t count) {
+  if constexpr (W == 2 || W == 4 || W == 8) {
+    static const bswap_fn fn = select_bswap<W>();
+    return fn(from, to, count);
+  } else {
+    return 0;
+  }
+}
+
+static inline unsigned ctz64(uint64_t v) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  unsigned long i;
+  _BitScanForward64(&i, v);
+  return static_cast<unsigned>(i);
+#else
+  return static_cast<unsigned>(__builtin_ctzll(v));
+#endif
+}
+
+// Byte search kernels return the index of the first match or `size`.
+
+using find_byte_fn = size_t (*)(const uint8_t *, size_t, uint8_t);
+
+static inline size_t find_byte_scalar(const uint8_t *from, size_t size,
+                                      uint8_t b) {
+  auto p = size ? static_cast<const uint8_t *>(memchr(from, b, size))
+                : nullptr;
+  return p ? static_cast<size_t>(p - from) : size;
+}
+
+#if defined(EX_BUFFER_X86)
+static inline unsigned find_mask_sse2(const uint8_t *p, __m128i needle) {
+  return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(
+      _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)), needle)));
+}
+
+static inline size_t find_byte_sse2(const uint8_t *from, size_t size,
+                                    uint8_t b) {
+  if (size < 16)
+    return find_byte_scalar(from, size, b);
+  auto needle = _mm_set1_epi8(static_cast<char>(b));
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16)
+    if (auto m = find_mask_sse2(from + i, needle))
+      return i + ctz64(m);
+  // The last block overlaps bytes already searched, which do not match.
+  if (auto m = find_mask_sse2(from + size - 16, needle))
+    return size - 16 + ctz64(m);
+  return size;
+}
+#endif
+
+#if defined(EX_BUFFER_DISPATCH)
+EX_BUFFER_TARGET("avx2")
+static inline __m256i find_eq_avx2(const uint8_t *p, __m256i needle) {
+  return _mm256_cmpeq_epi8(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), needle);
+}
+
+EX_BUFFER_TARGET("avx2")
+static inline uint64_t find_mask_avx2(const uint8_t *p, __m256i needle) {
+  return static_cast<uint32_t>(_mm256_movemask_epi8(find_eq_avx2(p, needle)));
+}
+
+EX_BUFFER_TARGET("avx2")
+static inline size_t find_byte_avx2(const uint8_t *from, size_t size,
+                                    uint8_t b) {
+  if (size < 32)
+    return find_byte_sse2(from, size, b);
+  auto needle = _mm256_set1_epi8(static_cast<char>(b));
+  if (auto m = find_mask_avx2(from, needle))
+    return ctz64(m);
+  // Continue from a 32-byte boundary so that no load splits a cache line,
+  // and test 128 bytes at a time; a block is searched again on a match.
+  size_t i = 32 - (reinterpret_cast<uintptr_t>(from) & 31);
+  for (; i + 128 <= size; i += 128) {
+    auto p = from + i;
+    auto any = _mm256_or_si256(
+        _mm256_or_si256(find_eq_avx2(p, needle), find_eq_avx2(p + 32, needle)),
+        _mm256_or_si256(find_eq_avx2(p + 64, needle),
+                        find_eq_avx2(p + 96, needle)));
+    if (!_mm256_testz_si256(any, any))
+      break;
+  }
+  for (; i + 32 <= size; i += 32)
+    if (auto m = find_mask_avx2(from + i, needle))
+      return i + ctz64(m);
+  if (auto m = find_mask_avx2(from + size - 32, needle))
+    return size - 32 + ctz64(m);
+  return size;
+}
+#endif
+
+#if defined(EX_BUFFER_NEON)
+// Four bits per byte of a comparison result.
+static inline uint64_t find_mask_neon(uint8x16_t eq) {
+  return vget_lane_u64(
+      vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+}
+
+static inline size_t find_byte_neon(const uint8_t *from, size_t size,
+                                    uint8_t b) {
+  if (size < 16)
+    return find_byte_scalar(from, size, b);
+  auto needle = vdupq_n_u8(b);
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16)
+    if (auto m = find_mask_neon(vceqq_u8(vld1q_u8(from + i), needle)))
+      return i + ctz64(m) / 4;
+  if (auto m = find_mask_neon(vceqq_u8(vld1q_u8(from + size - 16), needle)))
+    return size - 16 + ctz64(m) / 4;
+  return size;
+}
+#endif
+
+static inline find_byte_fn select_find_byte() {
+#if defined(EX_BUFFER_DISPATCH)
+  if (cpu().avx2)
+    return find_byte_avx2;
+#endif
+#if defined(EX_BUFFER_X86)
+  return find_byte_sse2;
+#elif defined(EX_BUFFER_NEON)
+  return find_byte_neon;
+#else
+  return find_byte_scalar;
+#endif
+}
+
+static inline size_t find_byte(const uint8_t *from, size_t size, uint8_t b) {
+  static const find_byte_fn fn = select_find_byte();
+  return fn(from, size, b);
+}
+
+// Substring search for patterns of two or more bytes.
+using find_pattern_fn = size_t (*)(const uint8_t *, size_t, const uint8_t *,
+                                   size_t);
+
+static inline size_t find_pattern_scalar(const uint8_t *from, size_t size,
+                                         const uint8_t *pattern, size_t n) {
+  for (size_t i = 0; i + n <= size;) {
+    auto j = find_byte(from + i, size - i - n + 1, pattern[0]);
+    if (i + j + n > size)
+      break;
+    if (memcmp(from + i + j + 1, pattern + 1, n - 1) == 0)
+      return i + j;
+    i += j + 1;
+  }
+  return size;
+}
+
+#if defined(EX_BUFFER_X86)
+// Compares the pattern's first and last bytes at 16 positions at once and
+// checks only the positions where both match.
+static inline size_t find_pattern_sse2(const uint8_t *from, size_t size,
+                                       const uint8_t *pattern, size_t n) {
+  auto first = _mm_set1_epi8(static_cast<char>(pattern[0]));
+  auto last = _mm_set1_epi8(static_cast<char>(pattern[n - 1]));
+  size_t i = 0;
+  for (; i + n - 1 + 16 <= size; i += 16) {
+    auto m = find_mask_sse2(from + i, first) &
+             find_mask_sse2(from + i + n - 1, last);
+    for (; m; m &= m - 1) {
+      auto j = i + ctz64(m);
+      if (memcmp(from + j + 1, pattern + 1, n - 2) == 0)
+        return j;
+    }
+  }
+  auto j = find_pattern_scalar(from + i, size - i, pattern, n);
+  return j == size - i ? size : i + j;
+}
+#endif
+
+#if defined(EX_BUFFER_DISPATCH)
+EX_BUFFER_TARGET("avx2")
+static inline size_t find_pattern_avx2(const uint8_t *from, size_t size,
+                                       const uint8_t *pattern, size_t n) {
+  auto first = _mm256_set1_epi8(static_cast<char>(pattern[0]));
+  auto last = _mm256_set1_epi8(static_cast<char>(pattern[n - 1]));
+  size_t i = 0;
+  for (; i + n - 1 + 32 <= size; i += 32) {
+    auto m = find_mask_avx2(from + i, first) &
+             find_mask_avx2(from + i + n - 1, last);
+    for (; m; m &= m - 1) {
+      auto j = i + ctz64(m);
+      if (memcmp(from + j + 1, pattern + 1, n - 2) == 0)
+        return j;
+    }
+  }
+  auto j = find_pattern_sse2(from + i, size - i, pattern, n);
+  return j == size - i ? size : i + j;
+}
+#endif
+
+static inline find_pattern_fn select_find_pattern() {
+#if defined(EX_BUFFER_DISPATCH)
+  if (cpu().avx2)
+    return find_pattern_avx2;
+#endif
+#if defined(EX_BUFFER_X86)
+  return find_pattern_sse2;
+#else
+  return find_pattern_scalar;
+#endif
+}
+
+static inline size_t find_pattern(const uint8_t *from, size_t size,
+                                  const uint8_t *pattern, size_t n) {
+  if (n > size)
+    return size;
+  if (n <= 1)
+    return n ? find_byte(from, size, pattern[0]) : 0;
+  static const find_pattern_fn fn = select_find_pattern();
+  return fn(from, size, pattern, n);
+}
+
+// A set of bytes as two nibble-indexed tables: bit (c >> 4) & 7 of
+// lo[c & 15] (c < 0x80) or hi[c & 15] (c >= 0x80) is set for each member,
+// so one pshufb per table tests 16 or 32 bytes.
+struct byte_set {
+  alignas(16) uint8_t lo[16] = {};
+  alignas(16) uint8_t hi[16] = {};
+
+  byte_set(const uint8_t *members, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+      add(members[i]);
+  }
+
+  void add(uint8_t c) {
+    (c < 0x80 ? lo : hi)[c & 15] |= static_cast<uint8_t>(1 << (c >> 4 & 7));
+  }
+
+  bool contains(uint8_t c) const {
+    return (c < 0x80 ? lo : hi)[c & 15] >> (c >> 4 & 7) & 1;
+  }
+};
+
+using find_any_fn = size_t (*)(const uint8_t *, size_t, const byte_set &);
+
+static inline size_t find_any_scalar(const uint8_t *from, size_t size,
+                                     const byte_set &set) {
+  for (size_t i = 0; i < size; ++i)
+    if (set.contains(from[i]))
+      return i;
+  return size;
+}
+
+#if defined(EX_BUFFER_DISPATCH)
+EX_BUFFER_TARGET("ssse3")
+static inline unsigned find_any_mask_ssse3(__m128i v, __m128i lo, __m128i hi,
+                                           __m128i bits) {
+  auto row = _mm_or_si128(
+      _mm_shuffle_epi8(lo, v),
+      _mm_shuffle_epi8(hi, _mm_xor_si128(v, _mm_set1_epi8(-128))));
+  auto bit = _mm_shuffle_epi8(
+      bits, _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x0f)));
+  return static_cast<unsigned>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), bit)));
+}
+
+EX_BUFFER_TARGET("ssse3")
+static inline size_t find_any_ssse3(const uint8_t *from, size_t size,
+                                    const byte_set &set) {
+  if (size < 16)
+    return find_any_scalar(from, size, set);
+  auto lo = _mm_load_si128(reinterpret_cast<const __m128i *>(set.lo));
+  auto hi = _mm_load_si128(reinterpret_cast<const __m128i *>(set.hi));
+  auto bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32,
+                            64, -128);
+  auto load = [&](size_t i) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(from + i));
+  };
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16)
+    if (auto m = find_any_mask_ssse3(load(i), lo, hi, bits))
+      return i + ctz64(m);
+  if (auto m = find_any_mask_ssse3(load(size - 16), lo, hi, bits))
+    return size - 16 + ctz64(m);
+  return size;
+}
+
+EX_BUFFER_TARGET("avx2")
+static inline uint64_t find_any_mask_avx2(const uint8_t *p, __m256i lo,
+                                          __m256i hi, __m256i bits) {
+  auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  auto row = _mm256_or_si256(
+      _mm256_shuffle_epi8(lo, v),
+      _mm256_shuffle_epi8(hi, _mm256_xor_si256(v, _mm256_set1_epi8(-128))));
+  auto bit = _mm256_shuffle_epi8(
+      bits,
+      _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0f)));
+  return static_cast<uint32_t>(_mm256_movemask_epi8(
+      _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit)));
+}
+
+EX_BUFFER_TARGET("avx2")
+static inline size_t find_any_avx2(const uint8_t *from, size_t size,
+                                   const byte_set &set) {
+  if (size < 32)
+    return find_any_ssse3(from, size, set);
+  auto lo = _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<const __m128i *>(set.lo)));
+  auto hi = _mm256_broadcastsi128_si256(
+      _mm_load_si128(reinterpret_cast<const __m128i *>(set.hi)));
+  auto bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16,
+                               32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, 1,
+                               2, 4, 8, 16, 32, 64, -128);
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32)
+    if (auto m = find_any_mask_avx2(from + i, lo, hi, bits))
+      return i + ctz64(m);
+  if (auto m = find_any_mask_avx2(from + size - 32, lo, hi, bits))
+    return size - 32 + ctz64(m);
+  return size;
+}
+#endif
+
+#if defined(EX_BUFFER_NEON)
+static inline size_t find_any_neon(const uint8_t *from, size_t size,
+                                   const byte_set &set) {
+  if (size < 16)
+    return find_any_scalar(from, size, set);
+  static const uint8_t bit_values[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                         1, 2, 4, 8, 16, 32, 64, 128};
+  auto lo = vld1q_u8(set.lo);
+  auto hi = vld1q_u8(set.hi);
+  auto bits = vld1q_u8(bit_values);
+  auto mask = [&](size_t i) {
+    auto v = vld1q_u8(from + i);
+    auto low = vandq_u8(v, vdupq_n_u8(0x0f));
+    auto row = vbslq_u8(vcgeq_u8(v, vdupq_n_u8(0x80)), vqtbl1q_u8(hi, low),
+                        vqtbl1q_u8(lo, low));
+    return find_mask_neon(vtstq_u8(row, vqtbl1q_u8(bits, vshrq_n_u8(v, 4))));
+  };
+  size_t i = 0;
+  for (; i + 16 <= size; i += 16)
+    if (auto m = mask(i))
+      return i + ctz64(m) / 4;
+  if (auto m = mask(size - 16))
+    return size - 16 + ctz64(m) / 4;
+  return size;
+}
+#endif
+
+static inline find_any_fn select_find_any() {
+#if defined(EX_BUFFER_DISPATCH)
+  if (cpu().avx2)
+    return find_any_avx2;
+  if (cpu().ssse3)
+    return find_any_ssse3;
+#elif defined(EX_BUFFER_NEON)
+  return find_any_neon;
+#endif
+  return find_any_scalar;
+}
+
+static inline size_t find_any(const uint8_t *from, size_t size,
+                              const uint8_t *members, size_t n) {
+  if (n == 1)
+    return find_byte(from, size, members[0]);
+  static const find_any_fn fn = select_find_any();
+  return fn(from, size, byte_set(members, n));
+}
+
+} // namespace _buffer_simd_
+} // namespace ex
@@ -1,106 +1,289 @@
 #pragma once
 
+#include "buffer_simd.h"
+#include "buffer_varint.h"
 #include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <vector>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <stdlib.h>
+#endif
 
 namespace ex {
 
-template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, bool> = true>
+namespace _buffer_utils_ {
+static inline uint16_t bswap16(uint16_t v) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return _byteswap_ushort(v);
+#else
+  return __builtin_bswap16(v);
+#endif
+}
+
+static inline uint32_t bswap32(uint32_t v) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return _byteswap_ulong(v);
+#else
+  return __builtin_bswap32(v);
+#endif
+}
+
+static inline uint64_t bswap64(uint64_t v) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  return _byteswap_uint64(v);
+#else
+  return __builtin_bswap64(v);
+#endif
+}
+
+template <typename U, typename T> static inline U bit_cast(const T &t) {
+  static_assert(sizeof(U) == sizeof(T));
+  U u;
+  memcpy(&u, &t, sizeof(U));
+  return u;
+}
+
+// Decodes `hex`, which holds `digits` hex digits as counted by
+// hex_count_digits, so that callers sizing the output scan it only once.
+static inline size_t write_hex(uint8_t *to, std::string_view hex,
+                               size_t digits) {
+  if (digits != hex.size()) {
+    _buffer_simd_::hex_decode_split(hex.data(), hex.size(), digits, to);
+    return std::string::npos;
+  }
+  return _buffer_simd_::hex_decode(hex.data(), hex.size(), to);
+}
+
+static inline size_t hex_digits(std::string_view hex) {
+  return _buffer_simd_::hex_count_digits(hex.data(), hex.size());
+}
+
+// Appends the bytes of `hex`, holding `digits` hex digits, to a byte vector
+// whose allocator zero-fills on resize. Each chunk is decoded on the stack
+// and range-inserted, so the vector's storage is written only once.
+template <typename Vector>
+static inline void append_hex(Vector &v, std::string_view hex,
+                              size_t digits) {
+  constexpr size_t chunk = 1024;
+  char in[chunk * 2];
+  uint8_t out[chunk];
+  v.reserve(v.size() + (digits + 1) / 2);
+  auto flush = [&](const char *from, size_t n) {
+    _buffer_simd_::hex_decode(from, n, out);
+    v.insert(v.end(), out, out + (n + 1) / 2);
+  };
+  // An odd leading digit decodes alone, so the first chunk is one short.
+  auto cap = chunk * 2 - digits % 2;
+  if (digits == hex.size()) {
+    for (size_t i = 0; i < hex.size(); i += cap, cap = chunk * 2)
+      flush(hex.data() + i, std::min(cap, hex.size() - i));
+    return;
+  }
+  size_t n = 0;
+  for (auto c : hex) {
+    if (_buffer_simd_::hex_value(c) == 0xff)
+      continue;
+    in[n++] = c;
+    if (n == cap) {
+      flush(in, n);
+      n = 0;
+      cap = chunk * 2;
+    }
+  }
+  if (n)
+    flush(in, n);
+}
+} // namespace _buffer_utils_
+
+// The single-value accessors take any trivially copyable T. Enums swap as
+// their underlying type; other non-arithmetic types are reversed as a whole.
+template <typename T,
+          std::enable_if_t<std::is_trivially_copyable_v<T>, bool> = true>
 static inline T buffer_switch_endian(T t) {
-  auto p = reinterpret_cast<uint8_t *>(&t);
-  std::reverse(p, p + sizeof(T));
-  return t;
+  using namespace _buffer_utils_;
+  if constexpr (std::is_enum_v<T>) {
+    using U = std::underlying_type_t<T>;
+    return static_cast<T>(buffer_switch_endian(static_cast<U>(t)));
+  } else if constexpr (sizeof(T) == 1) {
+    return t;
+  } else if constexpr (sizeof(T) == 2) {
+    return bit_cast<T>(bswap16(bit_cast<uint16_t>(t)));
+  } else if constexpr (sizeof(T) == 4) {
+    return bit_cast<T>(bswap32(bit_cast<uint32_t>(t)));
+  } else if constexpr (sizeof(T) == 8) {
+    return bit_cast<T>(bswap64(bit_cast<uint64_t>(t)));
+  } else {
+    auto p = reinterpret_cast<uint8_t *>(&t);
+    std::reverse(p, p + sizeof(T));
+    return t;
+  }
 }
 
-template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, bool> = true>
+template <typename T,
+          std::enable_if_t<std::is_trivially_copyable_v<T>, bool> = true>
 static inline void buffer_write_le(void *to, T v) {
-  *reinterpret_cast<T *>(to) = v;
+  memcpy(to, &v, sizeof(T));
 }
 
-template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, bool> = true>
+template <typename T,
+          std::enable_if_t<std::is_trivially_copyable_v<T>, bool> = true>
 static inline void buffer_write_be(void *to, T v) {
-  *reinterpret_cast<T *>(to) = v;
-  auto p = reinterpret_cast<uint8_t *>(to);
-  std::reverse(p, p + sizeof(T));
+  buffer_write_le(to, buffer_switch_endian(v));
+}
+
+template <typename T,
+          std::enable_if_t<std::is_trivially_copyable_v<T>, bool> = true>
+static inline T buffer_read_le(const void *from) {
+  T v;
+  memcpy(&v, from, sizeof(T));
+  return v;
+}
+
+template <typename T,
+          std::enable_if_t<std::is_trivially_copyable_v<T>, bool> = true>
+static inline T buffer_read_be(const void *from) {
+  return buffer_switch_endian(buffer_read_le<T>(from));
 }
 
 template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, bool> = true>
-static inline T buffer_read_le(void *from) {
-  return *reinterpret_cast<T *>(from);
+static inline void buffer_read_le_n(const void *from, T *to, size_t count) {
+  if (count)
+    memcpy(to, from, count * sizeof(T));
 }
 
 template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, bool> = true>
-static inline T buffer_read_be(void *from) {
-  return buffer_switch_endian(buffer_read_le<T>(from));
+static inline void buffer_write_le_n(void *to, const T *from, size_t count) {
+  if (count)
+    memcpy(to, from, count * sizeof(T));
+}
+
+template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, bool> = true>
+static inline void buffer_read_be_n(const void *from, T *to, size_t count) {
+  auto src = static_cast<const uint8_t *>(from);
+  auto i = _buffer_simd_::bswap_n<sizeof(T)>(
+      src, reinterpret_cast<uint8_t *>(to), count);
+  for (; i < count; ++i)
+    to[i] = buffer_read_be<T>(src + i * sizeof(T));
 }
 
-static inline void buffer_write_hex(void *to, std::string hex,
-                                    bool skip_splitters_remove = false) {
-  if (!skip_splitters_remove)
-    hex.erase(std::remove_if(hex.begin(), hex.end(),
-                             [](char c) {
-                               if (c < '0')
-                                 return true;
-                               if (c <= '9')
-                                 return false;
-                               if (c < 'A')
-                                 return true;
-                               if (c <= 'F')
-                                 return false;
-                               if (c < 'a')
-                                 return true;
-                               if (c <= 'f')
-                                 return false;
-                               return true;
-                             }),
-              hex.end());
-
-  auto hlen = hex.size();
-  auto len = hlen / 2;
-  auto odd = hlen % 2;
-  auto p = (uint8_t *)to;
-  for (size_t i = 0; i < len; ++i) {
-    *(p + (len - i - 1 + odd)) = static_cast<uint8_t>(
-        std::stoi(hex.substr(hlen - 2 - i * 2, 2), nullptr, 16));
+template <typename T, std::enable_if_t<std::is_arithmetic_v<T>, bool> = true>
+static inline void buffer_write_be_n(void *to, const T *from, size_t count) {
+  auto dst = static_cast<uint8_t *>(to);
+  auto i = _buffer_simd_::bswap_n<sizeof(T)>(
+      reinterpret_cast<const uint8_t *>(from), dst, count);
+  for (; i < count; ++i)
+    buffer_write_be(dst + i * sizeof(T), from[i]);
+}
+
+static constexpr uint64_t zigzag_encode(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+static constexpr int64_t zigzag_decode(uint64_t v) {
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+static inline size_t buffer_varint_size(uint64_t v) {
+  size_t n = 1;
+  while (v >= 0x80) {
+    v >>= 7;
+    ++n;
   }
-  if (odd)
-    *p = static_cast<uint8_t>(std::stoi(hex.substr(0, 1), nullptr, 16));
+  return n;
+}
+
+// Writes v as a LEB128 varint (at most 10 bytes); returns its length.
+static inline size_t buffer_write_varint(void *to, uint64_t v) {
+  auto p = static_cast<uint8_t *>(to);
+  if (v < 0x80) {
+    *p = static_cast<uint8_t>(v);
+    return 1;
+  }
+  size_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = static_cast<uint8_t>(v | 0x80);
+    v >>= 7;
+  }
+  p[n++] = static_cast<uint8_t>(v);
+  return n;
+}
+
+// Reads one varint from at most `size` bytes; returns its length, or 0 if
+// it is truncated or malformed.
+static inline size_t buffer_read_varint(const void *from, size_t size,
+                                        uint64_t &v) {
+  return _buffer_simd_::varint_decode(static_cast<const uint8_t *>(from),
+                                      size, v);
+}
+
+// Reads up to `count` consecutive varints; returns how many were read and
+// stores the bytes they used in `consumed`.
+static inline size_t buffer_read_varints(const void *from, size_t size,
+                                         uint64_t *to, size_t count,
+                                         size_t *consumed = nullptr) {
+  size_t used;
+  auto n = _buffer_simd_::varint_decode_n(static_cast<const uint8_t *>(from),
+                                          size, to, count, used);
+  if (consumed)
+    *consumed = used;
+  return n;
 }
 
-static inline std::string buffer_read_hex(void *from, size_t size,
+// The search functions return an index into `from`, or std::string::npos.
+static inline size_t buffer_find(const void *from, size_t size,
+                                 uint8_t byte) {
+  auto i = _buffer_simd_::find_byte(static_cast<const uint8_t *>(from), size,
+                                    byte);
+  return i == size ? std::string::npos : i;
+}
+
+// An empty pattern matches at 0.
+static inline size_t buffer_find(const void *from, size_t size,
+                                 const void *pattern, size_t pattern_size) {
+  auto i = _buffer_simd_::find_pattern(static_cast<const uint8_t *>(from),
+                                       size,
+                                       static_cast<const uint8_t *>(pattern),
+                                       pattern_size);
+  return i == size && pattern_size ? std::string::npos : i;
+}
+
+// The first byte that occurs in `set`.
+static inline size_t buffer_find_first_of(const void *from, size_t size,
+                                          std::string_view set) {
+  if (set.empty())
+    return std::string::npos;
+  auto members = reinterpret_cast<const uint8_t *>(set.data());
+  auto i = _buffer_simd_::find_any(static_cast<const uint8_t *>(from), size,
+                                   members, set.size());
+  return i == size ? std::string::npos : i;
+}
+
+static inline size_t buffer_hex_size(std::string_view hex) {
+  return (_buffer_utils_::hex_digits(hex) + 1) / 2;
+}
+
+// Returns the index of the first invalid character, or std::string::npos.
+// Unless skip_splitters_remove is set, non-hex characters are splitters.
+static inline size_t buffer_write_hex(void *to, std::string_view hex,
+                                      bool skip_splitters_remove = false) {
+  auto digits =
+      skip_splitters_remove ? hex.size() : _buffer_utils_::hex_digits(hex);
+  return _buffer_utils_::write_hex(static_cast<uint8_t *>(to), hex, digits);
+}
+
+static inline std::string buffer_read_hex(const void *from, size_t size,
                                           const std::string &splitter = "") {
   if (!size)
     return "";
   auto splen = splitter.size();
-  std::vector<char> str;
-  auto fr = (uint8_t *)from;
-  auto last = size - 1;
-  for (size_t i = 0; i < size; ++i) {
-    auto v = *(fr + i);
-    auto l = v >> 4;
-    auto r = v & 0xf;
-    if (l < 10) {
-      str.push_back('0' + l);
-    } else {
-      str.push_back('a' + l - 10);
-    }
-    if (r < 10) {
-      str.push_back('0' + r);
-    } else {
-      str.push_back('a' + r - 10);
-    }
-
-    if (splen && i != last) {
-      for (int j = 0; j < splen; ++j) {
-        str.push_back(splitter[j]);
-      }
-    }
-  }
-  return std::string(str.begin(), str.end());
+  std::string str(size * 2 + (size - 1) * splen, '\0');
+  _buffer_simd_::hex_encode(static_cast<const uint8_t *>(from), size,
+                            &str[0], splitter.data(), splen);
+  return str;
 }
 
 } // namespace ex
\ No newline at end of file
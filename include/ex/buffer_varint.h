@@ -0,0 +1,219 @@
+#pragma once
+
+#include "buffer_simd.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ex {
+namespace _buffer_simd_ {
+
+// Joins the 7-bit payloads of the eight little-endian bytes in x (high
+// bits already cleared) into one 56-bit value.
+static inline uint64_t varint_pack(uint64_t x) {
+  x = (x & 0x007f007f007f007full) | ((x & 0x7f007f007f007f00ull) >> 1);
+  x = (x & 0x00003fff00003fffull) | ((x & 0x3fff00003fff0000ull) >> 2);
+  return (x & 0x000000000fffffffull) | ((x & 0x0fffffff00000000ull) >> 4);
+}
+
+static inline size_t varint_decode_slow(const uint8_t *from, size_t size,
+                                        uint64_t &v) {
+  uint64_t r = 0;
+  for (size_t i = 0; i < size && i < 10; ++i) {
+    auto b = from[i];
+    // The tenth byte may only carry bit 63.
+    if (i == 9 && b > 1)
+      return 0;
+    r |= uint64_t(b & 0x7f) << (i * 7);
+    if (b < 0x80) {
+      v = r;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+// Decodes one LEB128 varint; returns its length, or 0 when it is truncated
+// or longer than 10 bytes. Single bytes take a predictable branch; other
+// varints of up to 8 bytes are decoded from one 64-bit load.
+static inline size_t varint_decode(const uint8_t *from, size_t size,
+                                   uint64_t &v) {
+  if (size && from[0] < 0x80) {
+    v = from[0];
+    return 1;
+  }
+  if (size >= 8) {
+    uint64_t x;
+    memcpy(&x, from, 8);
+    if (auto stops = ~x & 0x8080808080808080ull) {
+      auto len = ctz64(stops) / 8 + 1;
+      auto keep = len == 8 ? ~uint64_t(0) : (uint64_t(1) << (len * 8)) - 1;
+      v = varint_pack(x & keep & 0x7f7f7f7f7f7f7f7full);
+      return len;
+    }
+  }
+  return varint_decode_slow(from, size, v);
+}
+
+using varint_decode_n_fn = size_t (*)(const uint8_t *, size_t, uint64_t *,
+                                      size_t, size_t &);
+
+static inline size_t varint_decode_n_scalar(const uint8_t *from, size_t size,
+                                            uint64_t *to, size_t count,
+                                            size_t &consumed) {
+  size_t pos = 0, n = 0;
+  for (; n < count; ++n) {
+    auto len = varint_decode(from + pos, size - pos, to[n]);
+    if (!len)
+      break;
+    pos += len;
+  }
+  consumed = pos;
+  return n;
+}
+
+#if defined(EX_BUFFER_DISPATCH)
+// Masked VByte lookup keyed by the continuation bits of 12 bytes. Each
+// entry decodes either the leading six varints of one or two bytes or the
+// leading four of up to three, whichever is more, and picks a pair of
+// pshufb patterns that spread them into 32-bit lanes. Patterns are
+// numbered by their lengths: 126 of the first kind, then 120 of the second.
+struct varint_shuffle_table {
+  uint8_t pattern[4096];
+  uint8_t count[4096];
+  uint8_t consumed[4096];
+  uint8_t shuffle[246][32];
+
+  constexpr varint_shuffle_table()
+      : pattern(), count(), consumed(), shuffle() {
+    for (int m = 0; m < 4096; ++m) {
+      int len[6] = {}, n = 0, pos = 0;
+      while (n < 6 && pos < 12) {
+        int l = 1;
+        while (l <= 3 && pos + l - 1 < 12 && (m >> (pos + l - 1) & 1))
+          ++l;
+        if (l > 3 || pos + l > 12)
+          break;
+        len[n++] = l;
+        pos += l;
+      }
+      int k16 = 0, k32 = 0, bytes16 = 0, bytes32 = 0;
+      while (k16 < n && len[k16] <= 2)
+        bytes16 += len[k16++];
+      while (k32 < n && k32 < 4)
+        bytes32 += len[k32++];
+      bool wide = k16 < 6 && k32 > k16;
+      int k = wide ? k32 : k16;
+      int id = wide ? 126 + ((pow3(k) - 3) >> 1) : (1 << k) - 2;
+      for (int i = 0, digit = 1; i < k; ++i, digit *= wide ? 3 : 2)
+        id += (len[i] - 1) * digit;
+      if (k) {
+        pattern[m] = static_cast<uint8_t>(id);
+        count[m] = static_cast<uint8_t>(k);
+        consumed[m] = static_cast<uint8_t>(wide ? bytes32 : bytes16);
+        auto &sh = shuffle[id];
+        for (int j = 0; j < 32; ++j)
+          sh[j] = 0x80;
+        for (int i = 0, from = 0; i < k; from += len[i++])
+          for (int j = 0; j < len[i]; ++j)
+            sh[i * 4 + j] = static_cast<uint8_t>(from + j);
+      }
+    }
+  }
+
+  static constexpr int pow3(int k) { return k ? 3 * pow3(k - 1) : 1; }
+};
+
+inline constexpr varint_shuffle_table varint_shuffles{};
+
+EX_BUFFER_TARGET("ssse3")
+static inline void varint_store_u32x4(__m128i v, uint64_t *to) {
+  auto zero = _mm_setzero_si128();
+  _mm_storeu_si128((__m128i *)to, _mm_unpacklo_epi32(v, zero));
+  _mm_storeu_si128((__m128i *)(to + 2), _mm_unpackhi_epi32(v, zero));
+}
+
+// Joins the 7-bit payloads of up to three bytes in each 32-bit lane.
+EX_BUFFER_TARGET("ssse3")
+static inline __m128i varint_join_u32x4(__m128i v) {
+  auto low = _mm_and_si128(v, _mm_set1_epi32(0x7f));
+  auto mid = _mm_and_si128(v, _mm_set1_epi32(0x7f00));
+  auto high = _mm_and_si128(v, _mm_set1_epi32(0x7f0000));
+  return _mm_or_si128(_mm_or_si128(low, _mm_srli_epi32(mid, 1)),
+                      _mm_srli_epi32(high, 2));
+}
+
+EX_BUFFER_TARGET("ssse3")
+static inline void varint_store_u16x8(__m128i v, uint64_t *to) {
+  auto zero = _mm_setzero_si128();
+  varint_store_u32x4(_mm_unpacklo_epi16(v, zero), to);
+  varint_store_u32x4(_mm_unpackhi_epi16(v, zero), to + 4);
+}
+
+EX_BUFFER_TARGET("ssse3")
+static inline size_t varint_decode_n_ssse3(const uint8_t *from, size_t size,
+                                           uint64_t *to, size_t count,
+                                           size_t &consumed) {
+  size_t pos = 0, n = 0;
+  while (pos + 16 <= size && n + 16 <= count) {
+    auto v = _mm_loadu_si128((const __m128i *)(from + pos));
+    auto cont = static_cast<unsigned>(_mm_movemask_epi8(v));
+    if (!cont) {
+      auto zero = _mm_setzero_si128();
+      varint_store_u16x8(_mm_unpacklo_epi8(v, zero), to + n);
+      varint_store_u16x8(_mm_unpackhi_epi8(v, zero), to + n + 8);
+      pos += 16;
+      n += 16;
+      continue;
+    }
+    auto m = cont & 0xfff;
+    if (auto c = varint_shuffles.count[m]) {
+      auto sh = varint_shuffles.shuffle[varint_shuffles.pattern[m]];
+      varint_store_u32x4(
+          varint_join_u32x4(_mm_shuffle_epi8(
+              v, _mm_loadu_si128((const __m128i *)sh))),
+          to + n);
+      varint_store_u32x4(
+          varint_join_u32x4(_mm_shuffle_epi8(
+              v, _mm_loadu_si128((const __m128i *)(sh + 16)))),
+          to + n + 4);
+      pos += varint_shuffles.consumed[m];
+      n += c;
+      continue;
+    }
+    auto len = varint_decode(from + pos, size - pos, to[n]);
+    if (!len) {
+      consumed = pos;
+      return n;
+    }
+    pos += len;
+    ++n;
+  }
+  size_t tail;
+  n += varint_decode_n_scalar(from + pos, size - pos, to + n, count - n,
+                              tail);
+  consumed = pos + tail;
+  return n;
+}
+#endif
+
+static inline varint_decode_n_fn select_varint_decoder() {
+#if defined(EX_BUFFER_DISPATCH)
+  if (cpu().ssse3)
+    return varint_decode_n_ssse3;
+#endif
+  return varint_decode_n_scalar;
+}
+
+// Decodes up to `count` varints from `size` bytes; returns how many were
+// decoded and sets `consumed` to the bytes they used. Stops early at a
+// truncated or malformed varint.
+static inline size_t varint_decode_n(const uint8_t *from, size_t size,
+                                     uint64_t *to, size_t count,
+                                     size_t &consumed) {
+  static const varint_decode_n_fn fn = select_varint_decoder();
+  return fn(from, size, to, count, consumed);
+}
+
+} // namespace _buffer_simd_
+} // namespace ex
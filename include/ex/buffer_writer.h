@@ -0,0 +1,112 @@
+#pragma once
+
+#include "buffer.h"
+#include "buffer_utils.h"
+#include "shared_buffer.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace ex {
+
+// Appends to an ex::buffer. Capacity grows geometrically and the buffer's
+// size is the cursor, so nothing past it is written and the buffer always
+// holds exactly the written data.
+//
+//   buffer_writer w(frame, 64);
+//   auto len = w.placeholder<uint16_t>();
+//   w.write_be<uint32_t>(id);
+//   w.write(payload.data(), payload.size());
+//   w.patch_be(len, uint16_t(w.position() - len.offset - 2));
+class buffer_writer {
+public:
+  template <typename T> struct slot {
+    size_t offset;
+  };
+
+  explicit buffer_writer(buffer &b, size_t reserve_hint = 0) : m_buffer(b) {
+    reserve(reserve_hint);
+  }
+
+  buffer_writer(const buffer_writer &) = delete;
+  buffer_writer &operator=(const buffer_writer &) = delete;
+
+  // Makes room for n more bytes with at most one reallocation.
+  void reserve(size_t n) {
+    auto size = m_buffer.size();
+    if (size + n <= m_buffer.capacity())
+      return;
+    m_buffer.reserve(
+        std::max({size + n, m_buffer.capacity() * 2, size_t(64)}));
+  }
+
+  template <typename T> void write_le(T v) {
+    uint8_t b[sizeof(T)];
+    buffer_write_le(b, v);
+    write(b, sizeof(T));
+  }
+
+  template <typename T> void write_be(T v) {
+    uint8_t b[sizeof(T)];
+    buffer_write_be(b, v);
+    write(b, sizeof(T));
+  }
+
+  void write_varint(uint64_t v) {
+    uint8_t b[10];
+    write(b, buffer_write_varint(b, v));
+  }
+
+  void write(const void *from, size_t n) {
+    auto p = static_cast<const uint8_t *>(from);
+    m_buffer.insert(m_buffer.end(), p, p + n);
+  }
+
+  void write(const shared_buffer &b) { write(b.data(), b.size()); }
+
+  void fill(uint8_t v, size_t n) { m_buffer.insert(m_buffer.end(), n, v); }
+
+  // Returns the index of the first invalid character, or std::string::npos.
+  size_t write_hex(std::string_view hex) {
+    auto digits = _buffer_utils_::hex_digits(hex);
+    auto offset = m_buffer.size();
+    fill(0, (digits + 1) / 2);
+    return _buffer_utils_::write_hex(m_buffer.data() + offset, hex, digits);
+  }
+
+  // Reserves sizeof(T) bytes to be filled in later with patch_le/patch_be.
+  template <typename T> slot<T> placeholder() {
+    auto offset = position();
+    fill(0, sizeof(T));
+    return {offset};
+  }
+
+  template <typename T> void patch_le(slot<T> s, T v) {
+    buffer_write_le(m_buffer.data() + s.offset, v);
+  }
+
+  template <typename T> void patch_be(slot<T> s, T v) {
+    buffer_write_be(m_buffer.data() + s.offset, v);
+  }
+
+  // The bytes written so far from `offset`, e.g. for a checksum. Throws
+  // std::out_of_range past position().
+  shared_buffer view(size_t offset = 0) const {
+    if (offset > position())
+      throw std::out_of_range("ex::buffer_writer::view");
+    return shared_buffer(m_buffer.data() + offset, position() - offset);
+  }
+
+  size_t position() const { return m_buffer.size(); }
+  size_t capacity() const { return m_buffer.capacity(); }
+
+  buffer &finish() { return m_buffer; }
+
+private:
+  buffer &m_buffer;
+};
+} // namespace ex
@@ -0,0 +1,350 @@
+#pragma once
+
+#include "buffer.h"
+#include "buffer_simd.h"
+#include "buffer_utils.h"
+#include "shared_buffer.h"
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace ex {
+namespace _crc_ {
+// Slicing-by-8 tables for a reflected 32-bit polynomial: t[k][b] is the
+// CRC of byte b followed by k zero bytes.
+struct crc32_tables {
+  uint32_t t[8][256];
+  constexpr explicit crc32_tables(uint32_t poly) : t() {
+    for (uint32_t b = 0; b < 256; ++b) {
+      auto c = b;
+      for (int i = 0; i < 8; ++i)
+        c = (c >> 1) ^ (c & 1 ? poly : 0);
+      t[0][b] = c;
+    }
+    for (int k = 1; k < 8; ++k)
+      for (int b = 0; b < 256; ++b)
+        t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xff];
+  }
+};
+
+inline constexpr crc32_tables crc32c_tables{0x82f63b78};
+inline constexpr crc32_tables crc32_ieee_tables{0xedb88320};
+
+// Takes and returns the inverted (internal) CRC state.
+static inline uint32_t crc32_slice8(const crc32_tables &tab, const uint8_t *p,
+                                    size_t size, uint32_t crc) {
+  auto &t = tab.t;
+  for (; size >= 8; p += 8, size -= 8) {
+    auto lo = buffer_read_le<uint32_t>(p) ^ crc;
+    auto hi = buffer_read_le<uint32_t>(p + 4);
+    crc = t[7][lo & 0xff] ^ t[6][lo >> 8 & 0xff] ^ t[5][lo >> 16 & 0xff] ^
+          t[4][lo >> 24] ^ t[3][hi & 0xff] ^ t[2][hi >> 8 & 0xff] ^
+          t[1][hi >> 16 & 0xff] ^ t[0][hi >> 24];
+  }
+  for (; size; ++p, --size)
+    crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xff];
+  return crc;
+}
+
+using crc32_fn = uint32_t (*)(const uint8_t *, size_t, uint32_t);
+
+static inline uint32_t crc32c_scalar(const uint8_t *p, size_t size,
+                                     uint32_t crc) {
+  return crc32_slice8(crc32c_tables, p, size, crc);
+}
+
+static inline uint32_t crc32_ieee_scalar(const uint8_t *p, size_t size,
+                                         uint32_t crc) {
+  return crc32_slice8(crc32_ieee_tables, p, size, crc);
+}
+
+#if defined(__ARM_FEATURE_CRC32)
+static inline uint32_t crc32c_arm(const uint8_t *p, size_t size,
+                                  uint32_t crc) {
+  for (; size >= 8; p += 8, size -= 8)
+    crc = __crc32cd(crc, buffer_read_le<uint64_t>(p));
+  for (; size; ++p, --size)
+    crc = __crc32cb(crc, *p);
+  return crc;
+}
+
+static inline uint32_t crc32_ieee_arm(const uint8_t *p, size_t size,
+                                      uint32_t crc) {
+  for (; size >= 8; p += 8, size -= 8)
+    crc = __crc32d(crc, buffer_read_le<uint64_t>(p));
+  for (; size; ++p, --size)
+    crc = __crc32b(crc, *p);
+  return crc;
+}
+#endif
+
+#if defined(EX_BUFFER_DISPATCH)
+EX_BUFFER_TARGET("sse4.2")
+static inline uint32_t crc32c_sse42(const uint8_t *p, size_t size,
+                                    uint32_t crc) {
+#if defined(__x86_64__) || defined(_M_X64)
+  uint64_t c = crc;
+  for (; size >= 8; p += 8, size -= 8)
+    c = _mm_crc32_u64(c, buffer_read_le<uint64_t>(p));
+  crc = static_cast<uint32_t>(c);
+#endif
+  for (; size >= 4; p += 4, size -= 4)
+    crc = _mm_crc32_u32(crc, buffer_read_le<uint32_t>(p));
+  for (; size; ++p, --size)
+    crc = _mm_crc32_u8(crc, *p);
+  return crc;
+}
+
+static inline __m128i crc_load(const uint8_t *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+// Multiplies the two halves of x by the folding constants in k and adds
+// the next 16 bytes.
+EX_BUFFER_TARGET("sse4.2,pclmul")
+static inline __m128i crc_fold(__m128i x, __m128i k, __m128i next) {
+  auto lo = _mm_clmulepi64_si128(x, k, 0x00);
+  auto hi = _mm_clmulepi64_si128(x, k, 0x11);
+  return _mm_xor_si128(_mm_xor_si128(hi, lo), next);
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+// x^n mod P for the CRC-32C polynomial, bit-reflected.
+static constexpr uint32_t crc32c_xpow(unsigned n) {
+  uint64_t r = 1;
+  for (unsigned i = 0; i < n; ++i) {
+    r <<= 1;
+    if (r >> 32)
+      r ^= 0x11edc6f41;
+  }
+  uint32_t reflected = 0;
+  for (int i = 0; i < 32; ++i)
+    reflected |= static_cast<uint32_t>(r >> i & 1) << (31 - i);
+  return reflected;
+}
+
+// Advances a CRC-32C state over `bytes` zero bytes in constant time:
+// k = crc32c_xpow(8 * bytes - 33), where the 33 makes up for the product's
+// one-bit offset and the crc32 instruction's multiply by x^32.
+EX_BUFFER_TARGET("sse4.2,pclmul")
+static inline uint32_t crc32c_shift(uint32_t crc, uint32_t k) {
+  auto product = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(crc)),
+                                       _mm_cvtsi32_si128(static_cast<int>(k)),
+                                       0x00);
+  return static_cast<uint32_t>(_mm_crc32_u64(
+      0, static_cast<uint64_t>(_mm_cvtsi128_si64(product))));
+}
+
+// Runs three independent crc32 chains over consecutive thirds of each
+// 3 * Block bytes, hiding the instruction's 3-cycle latency, then joins
+// them with crc32c_shift.
+template <size_t Block>
+EX_BUFFER_TARGET("sse4.2,pclmul")
+static inline uint32_t crc32c_3way(const uint8_t *&p, size_t &size,
+                                   uint32_t crc) {
+  constexpr auto k1 = crc32c_xpow(8 * Block - 33);
+  constexpr auto k2 = crc32c_xpow(16 * Block - 33);
+  for (; size >= 3 * Block; p += 3 * Block, size -= 3 * Block) {
+    uint64_t a = crc, b = 0, c = 0;
+    for (size_t i = 0; i < Block; i += 8) {
+      a = _mm_crc32_u64(a, buffer_read_le<uint64_t>(p + i));
+      b = _mm_crc32_u64(b, buffer_read_le<uint64_t>(p + Block + i));
+      c = _mm_crc32_u64(c, buffer_read_le<uint64_t>(p + 2 * Block + i));
+    }
+    crc = crc32c_shift(static_cast<uint32_t>(a), k2) ^
+          crc32c_shift(static_cast<uint32_t>(b), k1) ^
+          static_cast<uint32_t>(c);
+  }
+  return crc;
+}
+
+EX_BUFFER_TARGET("sse4.2,pclmul")
+static inline uint32_t crc32c_sse42_pclmul(const uint8_t *p, size_t size,
+                                           uint32_t crc) {
+  crc = crc32c_3way<1024>(p, size, crc);
+  crc = crc32c_3way<128>(p, size, crc);
+  return crc32c_sse42(p, size, crc);
+}
+#endif
+
+// Folds 64 bytes per step with carry-less multiplies and Barrett-reduces
+// the result, after Intel's "Fast CRC Computation for Generic Polynomials
+// Using PCLMULQDQ" with the bit-reflected constants for 0xedb88320.
+EX_BUFFER_TARGET("sse4.2,pclmul")
+static inline uint32_t crc32_ieee_pclmul(const uint8_t *p, size_t size,
+                                         uint32_t crc) {
+  if (size < 64)
+    return crc32_ieee_scalar(p, size, crc);
+  auto seed = _mm_cvtsi32_si128(static_cast<int>(crc));
+  auto x1 = _mm_xor_si128(crc_load(p), seed);
+  auto x2 = crc_load(p + 16);
+  auto x3 = crc_load(p + 32);
+  auto x4 = crc_load(p + 48);
+  p += 64;
+  size -= 64;
+
+  auto k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+  for (; size >= 64; p += 64, size -= 64) {
+    x1 = crc_fold(x1, k1k2, crc_load(p));
+    x2 = crc_fold(x2, k1k2, crc_load(p + 16));
+    x3 = crc_fold(x3, k1k2, crc_load(p + 32));
+    x4 = crc_fold(x4, k1k2, crc_load(p + 48));
+  }
+
+  auto k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+  x1 = crc_fold(x1, k3k4, x2);
+  x1 = crc_fold(x1, k3k4, x3);
+  x1 = crc_fold(x1, k3k4, x4);
+  for (; size >= 16; p += 16, size -= 16)
+    x1 = crc_fold(x1, k3k4, crc_load(p));
+
+  // 128 to 64 bits.
+  auto low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8),
+                     _mm_clmulepi64_si128(x1, k3k4, 0x10));
+  auto k5 = _mm_set_epi64x(0, 0x0163cd6124);
+  x1 = _mm_xor_si128(
+      _mm_clmulepi64_si128(_mm_and_si128(x1, low32), k5, 0x00),
+      _mm_srli_si128(x1, 4));
+
+  // Barrett reduction to 32 bits.
+  auto poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+  auto t = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), poly, 0x10);
+  t = _mm_clmulepi64_si128(_mm_and_si128(t, low32), poly, 0x00);
+  crc = static_cast<uint32_t>(_mm_extract_epi32(_mm_xor_si128(x1, t), 1));
+  return crc32_ieee_scalar(p, size, crc);
+}
+#endif
+
+static inline crc32_fn select_crc32c() {
+#if defined(EX_BUFFER_DISPATCH)
+  auto &f = _buffer_simd_::cpu();
+#if defined(__x86_64__) || defined(_M_X64)
+  if (f.sse42 && f.pclmul)
+    return crc32c_sse42_pclmul;
+#endif
+  if (f.sse42)
+    return crc32c_sse42;
+#elif defined(__ARM_FEATURE_CRC32)
+  return crc32c_arm;
+#endif
+  return crc32c_scalar;
+}
+
+static inline crc32_fn select_crc32_ieee() {
+#if defined(EX_BUFFER_DISPATCH)
+  auto &f = _buffer_simd_::cpu();
+  if (f.sse42 && f.pclmul)
+    return crc32_ieee_pclmul;
+#elif defined(__ARM_FEATURE_CRC32)
+  return crc32_ieee_arm;
+#endif
+  return crc32_ieee_scalar;
+}
+
+struct crc16_table {
+  uint16_t t[256];
+  constexpr crc16_table(uint16_t poly, bool reflected) : t() {
+    for (int b = 0; b < 256; ++b) {
+      if (reflected) {
+        uint16_t c = static_cast<uint16_t>(b);
+        for (int i = 0; i < 8; ++i)
+          c = static_cast<uint16_t>((c >> 1) ^ (c & 1 ? poly : 0));
+        t[b] = c;
+      } else {
+        uint16_t c = static_cast<uint16_t>(b << 8);
+        for (int i = 0; i < 8; ++i)
+          c = static_cast<uint16_t>((c << 1) ^ (c & 0x8000 ? poly : 0));
+        t[b] = c;
+      }
+    }
+  }
+};
+
+inline constexpr crc16_table crc16_modbus_table{0xa001, true};
+inline constexpr crc16_table crc16_ccitt_table{0x1021, false};
+} // namespace _crc_
+
+// Each checksum continues from `crc`, the result for the preceding bytes,
+// so a message can be fed in pieces:
+//
+//   auto crc = ex::crc32c(header);
+//   crc = ex::crc32c(payload, crc);
+
+// CRC-32C (Castagnoli, iSCSI/ext4): SSE4.2 or ARMv8 crc32c instructions.
+static inline uint32_t crc32c(const void *data, size_t size,
+                              uint32_t crc = 0) {
+  static const _crc_::crc32_fn fn = _crc_::select_crc32c();
+  return ~fn(static_cast<const uint8_t *>(data), size, ~crc);
+}
+
+// CRC-32 (IEEE 802.3, zlib, PNG): PCLMULQDQ folding or ARMv8 crc32.
+static inline uint32_t crc32(const void *data, size_t size, uint32_t crc = 0) {
+  static const _crc_::crc32_fn fn = _crc_::select_crc32_ieee();
+  return ~fn(static_cast<const uint8_t *>(data), size, ~crc);
+}
+
+// CRC-16/MODBUS. Its result goes on the wire little-endian.
+static inline uint16_t crc16_modbus(const void *data, size_t size,
+                                    uint16_t crc = 0xffff) {
+  auto p = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i)
+    crc = static_cast<uint16_t>(
+        (crc >> 8) ^ _crc_::crc16_modbus_table.t[(crc ^ p[i]) & 0xff]);
+  return crc;
+}
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xffff); start from 0 for
+// CRC-16/XMODEM.
+static inline uint16_t crc16_ccitt(const void *data, size_t size,
+                                   uint16_t crc = 0xffff) {
+  auto p = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i)
+    crc = static_cast<uint16_t>(
+        (crc << 8) ^ _crc_::crc16_ccitt_table.t[((crc >> 8) ^ p[i]) & 0xff]);
+  return crc;
+}
+
+static inline uint32_t crc32c(const shared_buffer &b, uint32_t crc = 0) {
+  return crc32c(b.data(), b.size(), crc);
+}
+
+static inline uint32_t crc32(const shared_buffer &b, uint32_t crc = 0) {
+  return crc32(b.data(), b.size(), crc);
+}
+
+static inline uint16_t crc16_modbus(const shared_buffer &b,
+                                    uint16_t crc = 0xffff) {
+  return crc16_modbus(b.data(), b.size(), crc);
+}
+
+static inline uint16_t crc16_ccitt(const shared_buffer &b,
+                                   uint16_t crc = 0xffff) {
+  return crc16_ccitt(b.data(), b.size(), crc);
+}
+
+template <typename Alloc, typename Derived>
+uint32_t crc32c(const basic_buffer<Alloc, Derived> &b, uint32_t crc = 0) {
+  return crc32c(b.data(), b.size(), crc);
+}
+
+template <typename Alloc, typename Derived>
+uint32_t crc32(const basic_buffer<Alloc, Derived> &b, uint32_t crc = 0) {
+  return crc32(b.data(), b.size(), crc);
+}
+
+template <typename Alloc, typename Derived>
+uint16_t crc16_modbus(const basic_buffer<Alloc, Derived> &b,
+                      uint16_t crc = 0xffff) {
+  return crc16_modbus(b.data(), b.size(), crc);
+}
+
+template <typename Alloc, typename Derived>
+uint16_t crc16_ccitt(const basic_buffer<Alloc, Derived> &b,
+                     uint16_t crc = 0xffff) {
+  return crc16_ccitt(b.data(), b.size(), crc);
+}
+} // namespace ex
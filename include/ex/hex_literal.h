@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+namespace ex {
+namespace _hex_literal_ {
+constexpr int digit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+// Splitters must be printable punctuation or spaces, so typos such as
+// "0x3g" or a stray letter are rejected instead of being skipped.
+constexpr bool splitter(char c) {
+  return c == ' ' || (c > ' ' && c < 0x7f && !(c >= '0' && c <= '9') &&
+                      !(c >= 'a' && c <= 'z') && !(c >= 'A' && c <= 'Z'));
+}
+} // namespace _hex_literal_
+
+// Number of bytes `hex` decodes to. Throws std::invalid_argument on a
+// character that is neither a hex digit nor a splitter, which fails
+// compilation when evaluated in a constant expression.
+constexpr size_t hex_literal_size(std::string_view hex) {
+  size_t digits = 0;
+  for (auto c : hex) {
+    if (_hex_literal_::digit(c) >= 0)
+      ++digits;
+    else if (!_hex_literal_::splitter(c))
+      throw std::invalid_argument("ex::hex_literal_size: invalid character");
+  }
+  return (digits + 1) / 2;
+}
+
+// Decodes like buffer_write_hex: an odd leading digit becomes the low
+// nibble of the first byte.
+template <size_t N>
+constexpr std::array<uint8_t, N> hex_array(std::string_view hex) {
+  if (hex_literal_size(hex) != N)
+    throw std::invalid_argument("ex::hex_array: size mismatch");
+  std::array<uint8_t, N> a{};
+  size_t digits = 0;
+  for (auto c : hex)
+    digits += _hex_literal_::digit(c) >= 0;
+  bool low = digits % 2;
+  size_t i = 0;
+  int acc = 0;
+  for (auto c : hex) {
+    auto v = _hex_literal_::digit(c);
+    if (v < 0)
+      continue;
+    if (low)
+      a[i++] = static_cast<uint8_t>(acc << 4 | v);
+    else
+      acc = v;
+    low = !low;
+  }
+  return a;
+}
+} // namespace ex
+
+// Portable spelling: constexpr auto magic = EX_HEX("3c:fa:d3");
+// The array is read-only; view it as an ex::const_buffer, not a
+// shared_buffer, whose write_* methods would write into it.
+#define EX_HEX(str) ::ex::hex_array<::ex::hex_literal_size(str)>(str)
+
+#if defined(__GNUC__) || defined(__clang__)
+namespace ex {
+inline namespace literals {
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#if defined(__clang__)
+#pragma GCC diagnostic ignored "-Wgnu-string-literal-operator-template"
+#endif
+// "3c:fa:d3"_hex is a std::array<uint8_t, 3> decoded and validated at
+// compile time. String literal operator templates are a GNU extension
+// supported by GCC and Clang; use EX_HEX elsewhere.
+template <typename CharT, CharT... Cs> constexpr auto operator""_hex() {
+  constexpr char s[] = {static_cast<char>(Cs)..., '\0'};
+  constexpr auto a =
+      hex_array<hex_literal_size({s, sizeof...(Cs)})>({s, sizeof...(Cs)});
+  return a;
+}
+#pragma GCC diagnostic pop
+} // namespace literals
+} // namespace ex
+#endif
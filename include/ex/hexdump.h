@@ -0,0 +1,143 @@
+#pragma once
+
+#include "buffer_simd.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace ex {
+namespace _hexdump_ {
+template <typename, typename = void> constexpr bool has_write{};
+template <typename T>
+constexpr bool has_write<T, std::void_t<decltype(std::declval<T &>().write(
+                                std::declval<const char *>(), 0))>> = true;
+
+template <typename, typename = void> constexpr bool has_append{};
+template <typename T>
+constexpr bool has_append<T, std::void_t<decltype(std::declval<T &>().append(
+                                 std::declval<const char *>(), 0))>> = true;
+
+static inline char *put(char *p, std::string_view s) {
+  memcpy(p, s.data(), s.size());
+  return p + s.size();
+}
+
+static inline char *put_offset(char *p, uint64_t v, int digits) {
+  for (int i = digits - 1; i >= 0; --i) {
+    p[i] = _buffer_simd_::hex_pairs.v[(v & 0xf) * 2 + 1];
+    v >>= 4;
+  }
+  return p + digits;
+}
+
+static inline std::string more_bytes(size_t n) {
+  return "... (" + std::to_string(n) + " more bytes)";
+}
+} // namespace _hexdump_
+
+enum class hexdump_style {
+  // label { 3c fa d3 }
+  inline_bytes,
+  // hexdump -C: offset, 16 bytes in two groups and an ASCII column.
+  canonical,
+};
+
+struct hexdump_options {
+  hexdump_style style = hexdump_style::inline_bytes;
+  std::string_view label = "Buffer";
+  // Bytes shown before the dump is cut short; 0 shows everything.
+  size_t max_bytes = 0;
+};
+
+static inline std::string buffer_hexdump(const void *data, size_t size,
+                                         const hexdump_options &opts = {}) {
+  using namespace _hexdump_;
+  auto from = static_cast<const uint8_t *>(data);
+  auto shown = opts.max_bytes && opts.max_bytes < size ? opts.max_bytes : size;
+  auto tail = shown < size ? more_bytes(size - shown) : std::string();
+
+  if (opts.style == hexdump_style::inline_bytes) {
+    std::string s(opts.label.size() + 3 + shown * 3 +
+                      (tail.empty() ? 0 : tail.size() + 1) + 1,
+                  '\0');
+    auto p = put(&s[0], opts.label);
+    p = put(p, " { ");
+    if (shown) {
+      _buffer_simd_::hex_encode(from, shown, p, " ", 1);
+      p += shown * 3 - 1;
+      *p++ = ' ';
+    }
+    if (!tail.empty()) {
+      p = put(p, tail);
+      *p++ = ' ';
+    }
+    *p = '}';
+    return s;
+  }
+
+  constexpr size_t width = 16;
+  constexpr size_t line = 10 + width * 3 + 1 + 2 + width + 2;
+  auto lines = (shown + width - 1) / width;
+  auto digits = size > 0xffffffffu ? 16 : 8;
+  std::string s(lines * (line + digits - 8) +
+                    (tail.empty() ? 0 : tail.size() + 1) + digits + 1,
+                '\0');
+  char pairs[width * 2];
+  auto p = &s[0];
+  for (size_t off = 0; off < shown; off += width) {
+    auto n = shown - off < width ? shown - off : width;
+    _buffer_simd_::hex_encode(from + off, n, pairs);
+    p = put_offset(p, off, digits);
+    p = put(p, "  ");
+    for (size_t j = 0; j < width; ++j) {
+      if (j < n) {
+        memcpy(p, pairs + j * 2, 2);
+      } else {
+        p[0] = p[1] = ' ';
+      }
+      p[2] = ' ';
+      p += 3;
+      if (j == 7)
+        *p++ = ' ';
+    }
+    *p++ = ' ';
+    *p++ = '|';
+    for (size_t j = 0; j < n; ++j) {
+      auto c = from[off + j];
+      *p++ = c >= 0x20 && c < 0x7f ? static_cast<char>(c) : '.';
+    }
+    *p++ = '|';
+    *p++ = '\n';
+  }
+  if (!tail.empty()) {
+    p = put(p, tail);
+    *p++ = '\n';
+  }
+  p = put_offset(p, size, digits);
+  *p++ = '\n';
+  s.resize(static_cast<size_t>(p - s.data()));
+  return s;
+}
+
+// Formats the dump and hands it to `sink` in one write() or append() call,
+// e.g. a std::ostream, a std::string or a FILE-like wrapper.
+template <typename Sink>
+static inline Sink &buffer_hexdump(Sink &sink, const void *data, size_t size,
+                                   const hexdump_options &opts = {}) {
+  auto s = buffer_hexdump(data, size, opts);
+  if constexpr (_hexdump_::has_write<Sink>) {
+    sink.write(s.data(), s.size());
+  } else {
+    static_assert(_hexdump_::has_append<Sink>,
+                  "sink needs write(const char *, n) or append(const char *, "
+                  "n)");
+    sink.append(s.data(), s.size());
+  }
+  return sink;
+}
+} // namespace ex
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "shared_buffer.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+
+namespace ex {
+
+enum class map_advice {
+  normal,
+  sequential,
+  random,
+  willneed,
+  dontneed,
+  // Transparent huge pages; kernels without THP for file mappings decline.
+  hugepage,
+};
+
+// An owning memory mapping of a file. It is a shared_buffer over the whole
+// file, so the read/hex accessors work on it without copying. Writing
+// through a read-only mapping faults.
+//
+//   auto file = ex::mapped_buffer::open_readonly("capture.bin");
+//   file.advise(ex::map_advice::sequential);
+//   auto magic = file.read_be<uint32_t>(0);
+class mapped_buffer : public shared_buffer {
+public:
+  mapped_buffer() : shared_buffer((uint8_t *)nullptr, 0) {}
+
+  static mapped_buffer open_readonly(const std::string &path) {
+    return open(path, O_RDONLY, PROT_READ, 0);
+  }
+
+  // A non-zero size creates the file if needed and resizes it first.
+  static mapped_buffer open_readwrite(const std::string &path,
+                                      size_t size = 0) {
+    return open(path, size ? O_RDWR | O_CREAT : O_RDWR,
+                PROT_READ | PROT_WRITE, size);
+  }
+
+  mapped_buffer(mapped_buffer &&o) noexcept
+      : shared_buffer(std::exchange(o.m_ptr, nullptr),
+                      std::exchange(o.m_size, 0)),
+        m_writable(o.m_writable) {}
+
+  mapped_buffer &operator=(mapped_buffer &&o) noexcept {
+    if (this != &o) {
+      unmap();
+      m_ptr = std::exchange(o.m_ptr, nullptr);
+      m_size = std::exchange(o.m_size, 0);
+      m_writable = o.m_writable;
+    }
+    return *this;
+  }
+
+  mapped_buffer(const mapped_buffer &) = delete;
+  mapped_buffer &operator=(const mapped_buffer &) = delete;
+
+  ~mapped_buffer() { unmap(); }
+
+  // Returns false when the kernel rejects the hint. A zero length means
+  // "to the end".
+  bool advise(map_advice advice, size_t offset = 0, size_t length = 0) {
+    if (!m_ptr || offset >= m_size)
+      return false;
+    if (!length || length > m_size - offset)
+      length = m_size - offset;
+    auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto start = offset & ~(page - 1);
+    length += offset - start;
+    int flag = MADV_NORMAL;
+    switch (advice) {
+    case map_advice::normal:
+      break;
+    case map_advice::sequential:
+      flag = MADV_SEQUENTIAL;
+      break;
+    case map_advice::random:
+      flag = MADV_RANDOM;
+      break;
+    case map_advice::willneed:
+      flag = MADV_WILLNEED;
+      break;
+    case map_advice::dontneed:
+      flag = MADV_DONTNEED;
+      break;
+    case map_advice::hugepage:
+#ifdef MADV_HUGEPAGE
+      flag = MADV_HUGEPAGE;
+      break;
+#else
+      return false;
+#endif
+    }
+    return madvise(m_ptr + start, length, flag) == 0;
+  }
+
+  // Flushes writes to the file.
+  void sync() {
+    if (m_ptr && msync(m_ptr, m_size, MS_SYNC) != 0)
+      throw std::system_error(errno, std::generic_category(),
+                              "ex::mapped_buffer::sync");
+  }
+
+  // Throws std::out_of_range. A size of std::string::npos means "to the
+  // end".
+  shared_buffer view(size_t offset = 0,
+                     size_t size = std::string::npos) const {
+    if (offset > m_size)
+      throw std::out_of_range("ex::mapped_buffer::view");
+    if (size == std::string::npos)
+      size = m_size - offset;
+    if (size > m_size - offset)
+      throw std::out_of_range("ex::mapped_buffer::view");
+    return shared_buffer(m_ptr + offset, size);
+  }
+
+  bool writable() const { return m_writable; }
+
+private:
+  static mapped_buffer open(const std::string &path, int flags, int prot,
+                            size_t size) {
+    auto fail = [&](const char *what) {
+      throw std::system_error(errno, std::generic_category(),
+                              std::string("ex::mapped_buffer: ") + what +
+                                  " " + path);
+    };
+    int fd = ::open(path.c_str(), flags | O_CLOEXEC, 0644);
+    if (fd < 0)
+      fail("open");
+    struct fd_closer {
+      int fd;
+      ~fd_closer() { close(fd); }
+    } closer{fd};
+
+    if (size) {
+      if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+        fail("ftruncate");
+    } else {
+      struct stat st;
+      if (fstat(fd, &st) != 0)
+        fail("fstat");
+      size = static_cast<size_t>(st.st_size);
+    }
+
+    mapped_buffer m;
+    m.m_writable = prot & PROT_WRITE;
+    if (!size)
+      return m;
+    auto p = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+      fail("mmap");
+    m.m_ptr = static_cast<uint8_t *>(p);
+    m.m_size = size;
+    return m;
+  }
+
+  void unmap() {
+    if (m_ptr)
+      munmap(m_ptr, m_size);
+  }
+
+  bool m_writable = false;
+};
+} // namespace ex
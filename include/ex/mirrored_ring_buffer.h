@@ -0,0 +1,170 @@
+#pragma once
+
+#include "shared_buffer.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace ex {
+namespace _mirrored_ring_buffer_ {
+[[noreturn]] static inline void fail(const char *what) {
+  throw std::system_error(errno, std::generic_category(),
+                          std::string("ex::mirrored_ring_buffer: ") + what);
+}
+
+// An anonymous shared-memory file of `size` bytes.
+static inline int open_memory(size_t size) {
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+  int fd = memfd_create("ex::mirrored_ring_buffer", MFD_CLOEXEC);
+  const char *what = "memfd_create";
+#else
+  const char *what = "shm_open";
+  int fd = -1;
+  static std::atomic<unsigned> counter{0};
+  for (int attempt = 0; fd < 0 && attempt < 16; ++attempt) {
+    char name[64];
+    snprintf(name, sizeof(name), "/ex-ring-%d-%u", int(getpid()),
+             counter.fetch_add(1));
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0)
+      shm_unlink(name);
+    else if (errno != EEXIST)
+      break;
+  }
+#endif
+  if (fd < 0)
+    fail(what);
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    auto e = errno;
+    close(fd);
+    errno = e;
+    fail("ftruncate");
+  }
+  return fd;
+}
+} // namespace _mirrored_ring_buffer_
+
+// SPSC byte ring whose storage is mapped twice back to back, so every
+// readable or writable window of up to capacity() bytes is one contiguous
+// shared_buffer, including fields that straddle the wrap point.
+//
+//   auto r = ring.read_region(6);
+//   if (r.size() >= 6) {
+//     auto type = r.read_be<uint16_t>(0);
+//     auto len = r.read_be<uint32_t>(2);
+//     ring.commit_read(6);
+//   }
+class mirrored_ring_buffer {
+public:
+  // The capacity is rounded up to a power of two of at least a page.
+  explicit mirrored_ring_buffer(size_t capacity) {
+    size_t n = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    while (n < capacity)
+      n <<= 1;
+    m_mask = n - 1;
+
+    auto fd = _mirrored_ring_buffer_::open_memory(n);
+    auto base = mmap(nullptr, n * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+                     -1, 0);
+    if (base == MAP_FAILED) {
+      close(fd);
+      _mirrored_ring_buffer_::fail("mmap");
+    }
+    m_base = static_cast<uint8_t *>(base);
+    for (auto half : {m_base, m_base + n}) {
+      if (mmap(half, n, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+               0) == MAP_FAILED) {
+        auto e = errno;
+        munmap(m_base, n * 2);
+        close(fd);
+        errno = e;
+        _mirrored_ring_buffer_::fail("mmap");
+      }
+    }
+    close(fd);
+  }
+
+  mirrored_ring_buffer(const mirrored_ring_buffer &) = delete;
+  mirrored_ring_buffer &operator=(const mirrored_ring_buffer &) = delete;
+
+  ~mirrored_ring_buffer() { munmap(m_base, capacity() * 2); }
+
+  // Producer: the free space as one view. The consumer's index is
+  // reloaded only when the cached one leaves less than `want` bytes.
+  shared_buffer write_region(size_t want = 1) {
+    auto w = m_write.load(std::memory_order_relaxed);
+    auto space = capacity() - (w - m_read_cache);
+    if (space < want) {
+      m_read_cache = m_read.load(std::memory_order_acquire);
+      space = capacity() - (w - m_read_cache);
+    }
+    return shared_buffer(m_base + (w & m_mask), space);
+  }
+
+  void commit_write(size_t n) {
+    m_write.store(m_write.load(std::memory_order_relaxed) + n,
+                  std::memory_order_release);
+  }
+
+  // Producer: copies up to n bytes in and returns how many fit.
+  size_t write(const void *from, size_t n) {
+    auto r = write_region(n);
+    n = std::min(n, r.size());
+    if (n)
+      memcpy(r.data(), from, n);
+    commit_write(n);
+    return n;
+  }
+
+  // Consumer: the readable bytes as one view.
+  shared_buffer read_region(size_t want = 1) {
+    auto r = m_read.load(std::memory_order_relaxed);
+    auto avail = m_write_cache - r;
+    if (avail < want) {
+      m_write_cache = m_write.load(std::memory_order_acquire);
+      avail = m_write_cache - r;
+    }
+    return shared_buffer(m_base + (r & m_mask), avail);
+  }
+
+  void commit_read(size_t n) {
+    m_read.store(m_read.load(std::memory_order_relaxed) + n,
+                 std::memory_order_release);
+  }
+
+  // Consumer: copies up to n bytes out and returns how many were read.
+  size_t read(void *to, size_t n) {
+    auto r = read_region(n);
+    n = std::min(n, r.size());
+    if (n)
+      memcpy(to, r.data(), n);
+    commit_read(n);
+    return n;
+  }
+
+  size_t capacity() const { return m_mask + 1; }
+
+  // Approximate unless called from the producer or consumer thread.
+  size_t size() const {
+    return m_write.load(std::memory_order_acquire) -
+           m_read.load(std::memory_order_acquire);
+  }
+
+private:
+  uint8_t *m_base;
+  size_t m_mask;
+  alignas(64) std::atomic<size_t> m_write{0};
+  size_t m_read_cache = 0;
+  alignas(64) std::atomic<size_t> m_read{0};
+  size_t m_write_cache = 0;
+};
+} // namespace ex
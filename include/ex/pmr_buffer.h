@@ -0,0 +1,43 @@
+#pragma once
+
+#include "buffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace ex {
+using pmr_allocator =
+    default_init_allocator<uint8_t, std::pmr::polymorphic_allocator<uint8_t>>;
+
+// An ex::buffer drawing from a std::pmr::memory_resource:
+//
+//   ex::pmr_buffer b(&ex::thread_pool());
+//   auto frame = ex::pmr_buffer::from(p, n, &ex::thread_arena());
+//
+// Copies use the default resource, as with any pmr container.
+using pmr_buffer = basic_buffer<pmr_allocator>;
+
+// Bump allocator owned by the calling thread. Deallocation is a no-op and
+// memory is only returned by release(), so call it where no buffer from the
+// arena is alive, e.g. at the end of each request.
+inline std::pmr::monotonic_buffer_resource &thread_arena() {
+  thread_local std::pmr::monotonic_buffer_resource arena(size_t(64) << 10);
+  return arena;
+}
+
+// Size-class pool owned by the calling thread: blocks up to 64 KB are
+// recycled through per-size free lists without locking. Buffers must be
+// freed on the thread that allocated them, before that thread exits.
+inline std::pmr::unsynchronized_pool_resource &thread_pool() {
+  thread_local std::pmr::unsynchronized_pool_resource pool(
+      std::pmr::pool_options{0, size_t(64) << 10});
+  return pool;
+}
+
+// The same size classes behind a lock, for buffers that cross threads.
+inline std::pmr::synchronized_pool_resource &shared_pool() {
+  static std::pmr::synchronized_pool_resource pool(
+      std::pmr::pool_options{0, size_t(64) << 10});
+  return pool;
+}
+} // namespace ex
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "buffer.h"
+#include "shared_buffer.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+namespace ex {
+
+// An owning view. Copies and slices share the storage through an atomic
+// reference count, so they can be handed to other threads without copying
+// the bytes.
+class ref_buffer : public shared_buffer {
+public:
+  ref_buffer() : shared_buffer((uint8_t *)nullptr, 0) {}
+
+  explicit ref_buffer(size_t size) : ref_buffer(buffer(size)) {}
+
+  explicit ref_buffer(buffer &&b) : ref_buffer() {
+    auto owner = std::make_shared<buffer>(std::move(b));
+    m_ptr = owner->data();
+    m_size = owner->size();
+    m_owner = std::move(owner);
+  }
+
+  ref_buffer(std::shared_ptr<const void> owner, uint8_t *ptr, size_t size)
+      : shared_buffer(ptr, size), m_owner(std::move(owner)) {}
+
+  ref_buffer(const ref_buffer &) = default;
+  ref_buffer &operator=(const ref_buffer &) = default;
+
+  ref_buffer(ref_buffer &&o) noexcept
+      : shared_buffer(o.m_ptr, o.m_size), m_owner(std::move(o.m_owner)) {
+    o.m_ptr = nullptr;
+    o.m_size = 0;
+  }
+
+  ref_buffer &operator=(ref_buffer &&o) noexcept {
+    if (this != &o) {
+      m_ptr = std::exchange(o.m_ptr, nullptr);
+      m_size = std::exchange(o.m_size, 0);
+      m_owner = std::move(o.m_owner);
+    }
+    return *this;
+  }
+
+  static ref_buffer from(std::initializer_list<uint8_t> t) {
+    return ref_buffer(buffer::from(t));
+  }
+
+  template <typename Ptr, std::enable_if_t<std::is_pointer_v<Ptr>, bool> = true>
+  static ref_buffer from(Ptr p, size_t size) {
+    return ref_buffer(buffer::from(p, size));
+  }
+
+  template <typename T> static ref_buffer from(T &&t) {
+    return ref_buffer(buffer::from(std::forward<T>(t)));
+  }
+
+  ref_buffer slice(size_t offset, size_t size) const {
+    if (offset > m_size || size > m_size - offset)
+      throw std::out_of_range("ex::ref_buffer::slice");
+    return ref_buffer(m_owner, m_ptr + offset, size);
+  }
+
+  ref_buffer slice(size_t offset) const {
+    if (offset > m_size)
+      throw std::out_of_range("ex::ref_buffer::slice");
+    return slice(offset, m_size - offset);
+  }
+
+  buffer to_buffer() const { return buffer::from(m_ptr, m_size); }
+
+  long use_count() const { return m_owner.use_count(); }
+  const std::shared_ptr<const void> &owner() const { return m_owner; }
+
+private:
+  std::shared_ptr<const void> m_owner;
+};
+} // namespace ex
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "buffer.h"
+#include "shared_buffer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ex {
+
+// Up to two views over a ring: the second is non-empty when the region
+// wraps past the end of the storage.
+struct ring_regions {
+  shared_buffer first;
+  shared_buffer second;
+
+  size_t size() const { return first.size() + second.size(); }
+  bool empty() const { return size() == 0; }
+};
+
+// Single-producer/single-consumer byte ring. One thread calls the
+// write_* methods and another the read_* ones; neither blocks. Each side
+// keeps its index on its own cache line with a cached copy of the other
+// side's, so the shared line is only read when the cached copy leaves less
+// than the caller asked for.
+//
+//   // producer                        // consumer
+//   auto w = ring.write_regions();     auto r = ring.read_regions();
+//   auto n = recv(fd, w.first.data(),  if (r.first.size() >= 4)
+//                 w.first.size(), 0);    len = r.first.read_be<uint32_t>();
+//   ring.commit_write(n);              ring.commit_read(4);
+class ring_buffer {
+public:
+  // The capacity is rounded up to a power of two.
+  explicit ring_buffer(size_t capacity) {
+    size_t n = 1;
+    while (n < capacity)
+      n <<= 1;
+    m_storage = basic_buffer<>::uninitialized(n);
+    m_mask = n - 1;
+  }
+
+  ring_buffer(const ring_buffer &) = delete;
+  ring_buffer &operator=(const ring_buffer &) = delete;
+
+  // Producer: the free space, at most capacity() bytes. The consumer's
+  // index is reloaded only when the cached one leaves less than `want` bytes.
+  ring_regions write_regions(size_t want = 1) {
+    auto w = m_write.load(std::memory_order_relaxed);
+    auto space = capacity() - (w - m_read_cache);
+    if (space < want) {
+      m_read_cache = m_read.load(std::memory_order_acquire);
+      space = capacity() - (w - m_read_cache);
+    }
+    return regions(w, space);
+  }
+
+  // Producer: publishes n bytes written into write_regions().
+  void commit_write(size_t n) {
+    m_write.store(m_write.load(std::memory_order_relaxed) + n,
+                  std::memory_order_release);
+  }
+
+  // Producer: copies up to n bytes in and returns how many fit.
+  size_t write(const void *from, size_t n) {
+    auto r = write_regions(n);
+    n = std::min(n, r.size());
+    copy_in(r, static_cast<const uint8_t *>(from), n);
+    commit_write(n);
+    return n;
+  }
+
+  // Consumer: the bytes available to read. The producer's index is
+  // reloaded only when the cached one leaves less than `want` bytes.
+  ring_regions read_regions(size_t want = 1) {
+    auto r = m_read.load(std::memory_order_relaxed);
+    auto avail = m_write_cache - r;
+    if (avail < want) {
+      m_write_cache = m_write.load(std::memory_order_acquire);
+      avail = m_write_cache - r;
+    }
+    return regions(r, avail);
+  }
+
+  // Consumer: releases n bytes returned by read_regions().
+  void commit_read(size_t n) {
+    m_read.store(m_read.load(std::memory_order_relaxed) + n,
+                 std::memory_order_release);
+  }
+
+  // Consumer: copies up to n bytes from `offset` into the readable data
+  // without consuming them, e.g. a header that straddles the wrap.
+  size_t peek(void *to, size_t n, size_t offset = 0) {
+    auto r = read_regions(offset + n);
+    if (offset >= r.size())
+      return 0;
+    n = std::min(n, r.size() - offset);
+    copy_out(r, offset, static_cast<uint8_t *>(to), n);
+    return n;
+  }
+
+  // Consumer: copies up to n bytes out and returns how many were read.
+  size_t read(void *to, size_t n) {
+    n = peek(to, n);
+    commit_read(n);
+    return n;
+  }
+
+  size_t capacity() const { return m_mask + 1; }
+
+  // Approximate unless called from the producer or consumer thread.
+  size_t size() const {
+    return m_write.load(std::memory_order_acquire) -
+           m_read.load(std::memory_order_acquire);
+  }
+
+private:
+  ring_regions regions(size_t index, size_t n) {
+    auto offset = index & m_mask;
+    auto first = std::min(n, capacity() - offset);
+    return {shared_buffer(m_storage.data() + offset, first),
+            shared_buffer(m_storage.data(), n - first)};
+  }
+
+  static void copy_in(const ring_regions &r, const uint8_t *from, size_t n) {
+    auto first = std::min(n, r.first.size());
+    if (first)
+      memcpy(r.first.data(), from, first);
+    if (n > first)
+      memcpy(r.second.data(), from + first, n - first);
+  }
+
+  static void copy_out(const ring_regions &r, size_t offset, uint8_t *to,
+                       size_t n) {
+    auto first = r.first.size();
+    if (offset < first) {
+      auto chunk = std::min(n, first - offset);
+      memcpy(to, r.first.data() + offset, chunk);
+      to += chunk;
+      n -= chunk;
+      offset = first;
+    }
+    if (n)
+      memcpy(to, r.second.data() + (offset - first), n);
+  }
+
+  basic_buffer<> m_storage;
+  size_t m_mask;
+  alignas(64) std::atomic<size_t> m_write{0};
+  size_t m_read_cache = 0;
+  alignas(64) std::atomic<size_t> m_read{0};
+  size_t m_write_cache = 0;
+};
+} // namespace ex
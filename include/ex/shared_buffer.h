@@ -1,7 +1,9 @@
 #pragma once
 
 #include "buffer_utils.h"
+#include "hexdump.h"
 #include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstring>
 #include <iomanip>
@@ -9,6 +11,8 @@
 #include <iterator>
 #include <ostream>
 #include <sstream>
+#include <string>
+#include <string_view>
 #include <type_traits>
 
 namespace ex {
@@ -23,6 +27,8 @@ constexpr bool is_iterable<T, std::void_t<decltype(std::declval<T>().begin()),
     true;
 } // namespace _shared_buffer_
 
+class buffer_split;
+
 class shared_buffer {
 public:
   template <typename Ptr, std::enable_if_t<std::is_pointer_v<Ptr>, bool> = true>
@@ -32,14 +38,12 @@ public:
   template <
       typename Container,
       std::enable_if_t<_shared_buffer_::is_iterable<Container>, bool> = true>
-  explicit shared_buffer(Container &c, size_t offset = 0, size_t size = 0) {
-    using T = typename std::remove_reference<
-        decltype(std::declval<Container>().front())>::type;
-    if (size == 0)
-      size = sizeof(T) * c.size();
-    m_ptr = (uint8_t *)std::data(c) + offset;
-    m_size = size;
-  }
+  explicit shared_buffer(Container &c, size_t offset = 0, size_t size = 0)
+      : m_ptr((uint8_t *)std::data(c) + offset),
+        m_size(size ? size
+                    : sizeof(typename std::remove_reference<decltype(
+                                 std::declval<Container>().front())>::type) *
+                          c.size()) {}
 
   template <typename Arr, size_t N>
   explicit shared_buffer(const Arr (&a)[N], size_t offset = 0,
@@ -71,6 +75,38 @@ public:
     return buffer_read_be<T>(m_ptr + offset);
   }
 
+  template <typename T>
+  void read_le_n(T *to, size_t count, size_t offset = 0) const {
+    buffer_read_le_n(m_ptr + offset, to, count);
+  }
+
+  template <typename T>
+  void read_be_n(T *to, size_t count, size_t offset = 0) const {
+    buffer_read_be_n(m_ptr + offset, to, count);
+  }
+
+  template <typename T>
+  void write_le_n(const T *from, size_t count, size_t offset = 0) const {
+    buffer_write_le_n(m_ptr + offset, from, count);
+  }
+
+  template <typename T>
+  void write_be_n(const T *from, size_t count, size_t offset = 0) const {
+    buffer_write_be_n(m_ptr + offset, from, count);
+  }
+
+  // Return the varint's length; read_varint returns 0 when it is truncated
+  // or malformed.
+  size_t read_varint(uint64_t &v, size_t offset = 0) const {
+    return offset < m_size
+               ? buffer_read_varint(m_ptr + offset, m_size - offset, v)
+               : 0;
+  }
+
+  size_t write_varint(uint64_t v, size_t offset = 0) const {
+    return buffer_write_varint(m_ptr + offset, v);
+  }
+
   void fill(std::initializer_list<uint8_t> t, size_t offset = 0) const {
     std::copy(t.begin(), t.end(), m_ptr + offset);
   }
@@ -112,16 +148,54 @@ public:
     memcpy(m_ptr + offset, &n, sizeof(Num));
   }
 
-  void write_hex(std::string hex, size_t offset = 0,
-                 bool skip_splitters_remove = false) const {
-    buffer_write_hex(m_ptr + offset, hex, skip_splitters_remove);
+  size_t write_hex(std::string_view hex, size_t offset = 0,
+                   bool skip_splitters_remove = false) const {
+    return buffer_write_hex(m_ptr + offset, hex, skip_splitters_remove);
   }
 
   std::string read_hex(size_t offset, size_t size = 0,
-                       std::string splitter = "") const {
+                       const std::string &splitter = "") const {
+    if (!size)
+      size = m_size - offset;
     return buffer_read_hex(m_ptr + offset, size, splitter);
   }
 
+  static constexpr size_t npos = std::string::npos;
+
+  // Search from `offset` and return an index into the whole buffer, or npos.
+  size_t find(uint8_t byte, size_t offset = 0) const {
+    return offset > m_size
+               ? npos
+               : found(buffer_find(m_ptr + offset, m_size - offset, byte),
+                       offset);
+  }
+
+  size_t find(std::string_view pattern, size_t offset = 0) const {
+    return offset > m_size ? npos
+                           : found(buffer_find(m_ptr + offset, m_size - offset,
+                                               pattern.data(), pattern.size()),
+                                   offset);
+  }
+
+  size_t find(const shared_buffer &pattern, size_t offset = 0) const {
+    return offset > m_size ? npos
+                           : found(buffer_find(m_ptr + offset, m_size - offset,
+                                               pattern.m_ptr, pattern.m_size),
+                                   offset);
+  }
+
+  size_t find_first_of(std::string_view set, size_t offset = 0) const {
+    return offset > m_size
+               ? npos
+               : found(buffer_find_first_of(m_ptr + offset, m_size - offset,
+                                            set),
+                       offset);
+  }
+
+  // Views of the bytes between delimiters, found as the range is iterated.
+  buffer_split split(uint8_t delimiter) const;
+  buffer_split split(std::string_view delimiter) const;
+
   uint8_t at(size_t i) const { return *(m_ptr + i); }
   uint8_t &operator[](size_t i) const { return *(m_ptr + i); }
   uint8_t front() const { return at(0); }
@@ -202,25 +276,188 @@ public:
   auto size() const { return m_size; }
   auto *data() const { return m_ptr; }
 
+  // Compares the viewed bytes, not the pointers.
+  friend bool operator==(const shared_buffer &a, const shared_buffer &b) {
+    return a.m_size == b.m_size &&
+           (!a.m_size || memcmp(a.m_ptr, b.m_ptr, a.m_size) == 0);
+  }
+  friend bool operator!=(const shared_buffer &a, const shared_buffer &b) {
+    return !(a == b);
+  }
+
   auto to_string() const { return std::string(begin(), end()); }
   auto to_hex_string(const std::string &splitter = "") const {
     return buffer_read_hex(data(), m_size, splitter);
   }
 
   virtual std::string to_buffer_string() const {
-    std::ostringstream os;
-    os << "ex::shared_buffer (" << size() << ") { ";
-    for (auto u : *this) {
-      os << std::setfill('0') << std::setw(2) << std::hex << (int)u << ' ';
-    }
-    os << '}';
-    return os.str();
+    hexdump_options opts;
+    auto label = "ex::shared_buffer (" + std::to_string(m_size) + ")";
+    opts.label = label;
+    return buffer_hexdump(m_ptr, m_size, opts);
+  }
+
+  std::string hexdump(const hexdump_options &opts = {}) const {
+    return buffer_hexdump(m_ptr, m_size, opts);
   }
 
 protected:
+  static size_t found(size_t i, size_t offset) {
+    return i == npos ? npos : i + offset;
+  }
+
   uint8_t *m_ptr;
   size_t m_size;
 };
+
+// A read-only view, for bytes that must not be written through such as a
+// constexpr hex literal; shared_buffer would cast the const away. Every
+// shared_buffer converts to one.
+//
+//   static constexpr auto header = "3cfad3b00001"_hex;
+//   static constexpr ex::const_buffer view(header);
+class const_buffer {
+public:
+  constexpr const_buffer(const uint8_t *ptr, size_t size)
+      : m_ptr(ptr), m_size(size) {}
+
+  template <size_t N>
+  constexpr const_buffer(const std::array<uint8_t, N> &a)
+      : m_ptr(a.data()), m_size(N) {}
+
+  template <size_t N>
+  constexpr const_buffer(const uint8_t (&a)[N]) : m_ptr(a), m_size(N) {}
+
+  const_buffer(const shared_buffer &b) : m_ptr(b.data()), m_size(b.size()) {}
+
+  template <typename T> T read_le(size_t offset = 0) const {
+    return buffer_read_le<T>(m_ptr + offset);
+  }
+
+  template <typename T> T read_be(size_t offset = 0) const {
+    return buffer_read_be<T>(m_ptr + offset);
+  }
+
+  constexpr uint8_t at(size_t i) const { return m_ptr[i]; }
+  constexpr uint8_t operator[](size_t i) const { return m_ptr[i]; }
+  constexpr const uint8_t *begin() const { return m_ptr; }
+  constexpr const uint8_t *end() const { return m_ptr + m_size; }
+  constexpr size_t size() const { return m_size; }
+  constexpr const uint8_t *data() const { return m_ptr; }
+
+  friend bool operator==(const const_buffer &a, const const_buffer &b) {
+    return a.m_size == b.m_size &&
+           (!a.m_size || memcmp(a.m_ptr, b.m_ptr, a.m_size) == 0);
+  }
+  friend bool operator!=(const const_buffer &a, const const_buffer &b) {
+    return !(a == b);
+  }
+
+  auto to_string() const { return std::string(begin(), end()); }
+  auto to_hex_string(const std::string &splitter = "") const {
+    return buffer_read_hex(m_ptr, m_size, splitter);
+  }
+
+  std::string hexdump(const hexdump_options &opts = {}) const {
+    return buffer_hexdump(m_ptr, m_size, opts);
+  }
+
+private:
+  const uint8_t *m_ptr;
+  size_t m_size;
+};
+
+// The pieces of a buffer between delimiters. As with std::views::split,
+// n delimiters give n + 1 pieces, some of them empty; an empty delimiter
+// gives the whole buffer. Iterators refer to the range, which keeps a copy
+// of the delimiter.
+//
+//   for (auto line : packet.split('\n'))
+//     handle(line);
+class buffer_split {
+public:
+  buffer_split(const shared_buffer &b, uint8_t delimiter)
+      : m_buffer(b), m_delimiter(1, static_cast<char>(delimiter)) {}
+
+  buffer_split(const shared_buffer &b, std::string_view delimiter)
+      : m_buffer(b), m_delimiter(delimiter) {}
+
+  class iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using difference_type = std::ptrdiff_t;
+    using value_type = shared_buffer;
+    using pointer = const shared_buffer *;
+    using reference = const shared_buffer &;
+
+    iterator() = default;
+
+    reference operator*() const { return m_piece; }
+    pointer operator->() const { return &m_piece; }
+
+    iterator &operator++() {
+      if (m_next)
+        seek(m_next);
+      else
+        m_split = nullptr;
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    friend bool operator==(const iterator &a, const iterator &b) {
+      return a.m_split == b.m_split &&
+             (!a.m_split || a.m_piece.data() == b.m_piece.data());
+    }
+    friend bool operator!=(const iterator &a, const iterator &b) {
+      return !(a == b);
+    }
+
+  private:
+    friend class buffer_split;
+
+    iterator(const buffer_split *split, uint8_t *from) : m_split(split) {
+      seek(from);
+    }
+
+    void seek(uint8_t *from) {
+      auto &d = m_split->m_delimiter;
+      auto size = static_cast<size_t>(m_split->m_buffer.data() +
+                                      m_split->m_buffer.size() - from);
+      auto i = d.empty() ? shared_buffer::npos
+                         : buffer_find(from, size, d.data(), d.size());
+      if (i == shared_buffer::npos) {
+        m_piece = shared_buffer(from, size);
+        m_next = nullptr;
+      } else {
+        m_piece = shared_buffer(from, i);
+        m_next = from + i + d.size();
+      }
+    }
+
+    const buffer_split *m_split = nullptr;
+    shared_buffer m_piece{static_cast<uint8_t *>(nullptr), 0};
+    uint8_t *m_next = nullptr;
+  };
+
+  iterator begin() const { return iterator(this, m_buffer.data()); }
+  iterator end() const { return iterator(); }
+
+private:
+  shared_buffer m_buffer;
+  std::string m_delimiter;
+};
+
+inline buffer_split shared_buffer::split(uint8_t delimiter) const {
+  return buffer_split(*this, delimiter);
+}
+
+inline buffer_split shared_buffer::split(std::string_view delimiter) const {
+  return buffer_split(*this, delimiter);
+}
 } // namespace ex
 
 inline std::ostream &operator<<(std::ostream &os,
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "buffer.h"
+#include "buffer_utils.h"
+#include "shared_buffer.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace ex {
+namespace _static_buffer_ {
+// The ex::buffer from() factories, with the same results, for a Derived
+// that provides uninitialized(size).
+template <typename Derived> struct factories {
+  static Derived from(std::initializer_list<uint8_t> t) {
+    return from(t.begin(), t.size());
+  }
+
+  template <typename Ptr, std::enable_if_t<std::is_pointer_v<Ptr>, bool> = true>
+  static Derived from(Ptr p, size_t size) {
+    auto b = Derived::uninitialized(size);
+    std::copy(p, p + size, b.data());
+    return b;
+  }
+
+  template <typename Container,
+            std::enable_if_t<_buffer_::is_iterable<Container>, bool> = true>
+  static Derived from(Container &&c) {
+    using type = typename std::remove_reference<Container>::type::value_type;
+    constexpr auto size = sizeof(type);
+    if constexpr (size == 1) {
+      return from(std::forward<Container>(c), c.size());
+    } else {
+      // Each element is narrowed to a byte; the rest stays zero.
+      auto b = Derived::uninitialized(c.size() * size);
+      auto end = std::copy(c.begin(), c.end(), b.data());
+      std::fill(end, b.data() + b.size(), uint8_t(0));
+      return b;
+    }
+  }
+
+  template <typename Container,
+            std::enable_if_t<_buffer_::is_iterable<Container>, bool> = true>
+  static Derived from(Container &&c, size_t byte_length) {
+    auto b = Derived::uninitialized(byte_length);
+    if (byte_length)
+      memcpy(b.data(), c.data(), byte_length);
+    return b;
+  }
+
+  template <typename Arr, size_t N> static Derived from(Arr (&a)[N]) {
+    auto size = std::is_same_v<Arr, const char> ? N - 1 : sizeof(Arr[N]);
+    auto b = Derived::uninitialized(size);
+    memcpy(b.data(), a, size);
+    return b;
+  }
+
+  template <typename Str,
+            std::enable_if_t<std::is_same_v<const char *, Str>, bool> = true>
+  static Derived from(Str str) {
+    return from(str, strlen(str));
+  }
+
+  template <typename Num,
+            std::enable_if_t<std::is_arithmetic_v<Num>, bool> = true>
+  static Derived from(Num n) {
+    auto b = Derived::uninitialized(sizeof(Num));
+    memcpy(b.data(), &n, sizeof(Num));
+    return b;
+  }
+
+  static Derived from_hex(std::string_view str) {
+    auto digits = _buffer_utils_::hex_digits(str);
+    auto b = Derived::uninitialized((digits + 1) / 2);
+    _buffer_utils_::write_hex(b.data(), str, digits);
+    return b;
+  }
+};
+} // namespace _static_buffer_
+
+// A buffer of up to N bytes stored inline, e.g. on the stack. Growing past
+// N throws std::length_error. Copies and moves copy the bytes and keep
+// data() pointing at the object's own storage.
+template <size_t N>
+class static_buffer : public shared_buffer,
+                      public _static_buffer_::factories<static_buffer<N>> {
+public:
+  static_buffer() : shared_buffer(static_cast<uint8_t *>(m_storage), 0) {}
+
+  explicit static_buffer(size_t size) : static_buffer() { resize(size); }
+
+  static_buffer(const static_buffer &o)
+      : shared_buffer(static_cast<uint8_t *>(m_storage), o.m_size) {
+    memcpy(m_storage, o.m_storage, o.m_size);
+  }
+
+  static_buffer &operator=(const static_buffer &o) {
+    m_size = o.m_size;
+    memmove(m_storage, o.m_storage, o.m_size);
+    return *this;
+  }
+
+  static static_buffer uninitialized(size_t size) {
+    static_buffer b;
+    b.resize_uninitialized(size);
+    return b;
+  }
+
+  void resize(size_t size) {
+    auto old = m_size;
+    resize_uninitialized(size);
+    if (size > old)
+      memset(m_storage + old, 0, size - old);
+  }
+
+  void resize_uninitialized(size_t size) {
+    if (size > N)
+      throw std::length_error("ex::static_buffer: size exceeds capacity");
+    m_size = size;
+  }
+
+  void clear() { m_size = 0; }
+  bool empty() const { return m_size == 0; }
+  static constexpr size_t capacity() { return N; }
+
+  buffer to_buffer() const { return buffer::from(m_ptr, m_size); }
+
+  std::string to_buffer_string() const override {
+    hexdump_options opts;
+    auto label = "ex::static_buffer<" + std::to_string(N) + "> (" +
+                 std::to_string(m_size) + ")";
+    opts.label = label;
+    return buffer_hexdump(m_ptr, m_size, opts);
+  }
+
+private:
+  alignas(16) uint8_t m_storage[N];
+};
+
+// Stores up to N bytes inline and moves to a heap block when it grows past
+// N. Moving a heap-backed small_buffer steals the block.
+template <size_t N>
+class small_buffer : public shared_buffer,
+                     public _static_buffer_::factories<small_buffer<N>> {
+public:
+  small_buffer() : shared_buffer(static_cast<uint8_t *>(m_storage), 0) {}
+
+  explicit small_buffer(size_t size) : small_buffer() { resize(size); }
+
+  small_buffer(const small_buffer &o) : small_buffer() {
+    resize_uninitialized(o.m_size);
+    memcpy(m_ptr, o.m_ptr, o.m_size);
+  }
+
+  small_buffer(small_buffer &&o) noexcept : small_buffer() { steal(o); }
+
+  small_buffer &operator=(const small_buffer &o) {
+    if (this != &o) {
+      resize_uninitialized(o.m_size);
+      memcpy(m_ptr, o.m_ptr, o.m_size);
+    }
+    return *this;
+  }
+
+  small_buffer &operator=(small_buffer &&o) noexcept {
+    if (this != &o) {
+      m_heap.reset();
+      m_ptr = m_storage;
+      m_capacity = N;
+      steal(o);
+    }
+    return *this;
+  }
+
+  static small_buffer uninitialized(size_t size) {
+    small_buffer b;
+    b.resize_uninitialized(size);
+    return b;
+  }
+
+  void reserve(size_t capacity) {
+    if (capacity <= m_capacity)
+      return;
+    capacity = std::max(capacity, m_capacity * 2);
+    auto heap = std::unique_ptr<uint8_t[]>(new uint8_t[capacity]);
+    memcpy(heap.get(), m_ptr, m_size);
+    m_heap = std::move(heap);
+    m_ptr = m_heap.get();
+    m_capacity = capacity;
+  }
+
+  void resize(size_t size) {
+    auto old = m_size;
+    resize_uninitialized(size);
+    if (size > old)
+      memset(m_ptr + old, 0, size - old);
+  }
+
+  void resize_uninitialized(size_t size) {
+    reserve(size);
+    m_size = size;
+  }
+
+  void clear() { m_size = 0; }
+  bool empty() const { return m_size == 0; }
+  size_t capacity() const { return m_capacity; }
+  bool is_inline() const { return m_ptr == m_storage; }
+
+  buffer to_buffer() const { return buffer::from(m_ptr, m_size); }
+
+  std::string to_buffer_string() const override {
+    hexdump_options opts;
+    auto label = "ex::small_buffer<" + std::to_string(N) + "> (" +
+                 std::to_string(m_size) + ")";
+    opts.label = label;
+    return buffer_hexdump(m_ptr, m_size, opts);
+  }
+
+private:
+  void steal(small_buffer &o) {
+    if (o.is_inline()) {
+      memcpy(m_storage, o.m_storage, o.m_size);
+    } else {
+      m_heap = std::move(o.m_heap);
+      m_ptr = m_heap.get();
+      m_capacity = o.m_capacity;
+      o.m_ptr = o.m_storage;
+      o.m_capacity = N;
+    }
+    m_size = std::exchange(o.m_size, 0);
+  }
+
+  alignas(16) uint8_t m_storage[N];
+  std::unique_ptr<uint8_t[]> m_heap;
+  size_t m_capacity = N;
+};
+} // namespace ex
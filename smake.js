@@ -15,4 +15,9 @@ test.ldflags = [
 vscode(test);
 LibBuffer.config(test);
 
-module.exports = [test];
+const bench = new LLVM('bench', 'x86_64-linux-gnu');
+bench.files = ['bench/bench.cc'];
+bench.cxflags = [...bench.cxflags, '-O3'];
+LibBuffer.config(bench);
+
+module.exports = [test, bench];
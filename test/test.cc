@@ -1,16 +1,42 @@
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <chrono>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ex/aligned_buffer.h>
+#include <ex/bit_reader.h>
+#include <ex/bit_writer.h>
 #include <ex/buffer.h>
+#include <ex/buffer_chain.h>
+#include <ex/buffer_hash.h>
+#include <ex/buffer_pool.h>
+#include <ex/buffer_reader.h>
+#include <ex/buffer_writer.h>
+#include <ex/crc.h>
+#include <ex/hex_literal.h>
+#include <ex/hexdump.h>
+#include <ex/mapped_buffer.h>
+#include <ex/mirrored_ring_buffer.h>
+#include <ex/pmr_buffer.h>
 #include <ex/buffer_utils.h>
+#include <ex/ref_buffer.h>
+#include <ex/ring_buffer.h>
 #include <ex/shared_buffer.h>
+#include <ex/static_buffer.h>
 #include <iostream>
+#include <map>
+#include <stdexcept>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <system_error>
 #include <type_traits>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
@@ -59,6 +85,187 @@ TEST_CASE("buffer_utils") {
   CHECK(b[5] == 0x01);
 }
 
+TEST_CASE("buffer_switch_endian") {
+  CHECK(ex::buffer_switch_endian<uint8_t>(0x12) == 0x12);
+  CHECK(ex::buffer_switch_endian<uint16_t>(0x1234) == 0x3412);
+  CHECK(ex::buffer_switch_endian<int16_t>(0x0180) == -0x7fff);
+  CHECK(ex::buffer_switch_endian<uint32_t>(0x12345678) == 0x78563412);
+  CHECK(ex::buffer_switch_endian<uint64_t>(0x0102030405060708) ==
+        0x0807060504030201);
+  CHECK(ex::buffer_switch_endian(ex::buffer_switch_endian(1.5f)) == 1.5f);
+  CHECK(ex::buffer_switch_endian(ex::buffer_switch_endian(-2.25)) == -2.25);
+
+  auto b = ex::buffer(8);
+  ex::buffer_write_be(b.data(), 1.0);
+  CHECK(b[0] == 0x3f);
+  CHECK(b[1] == 0xf0);
+  CHECK(ex::buffer_read_be<double>(b.data()) == 1.0);
+  b.write_be(-1.0f, 4);
+  CHECK(b[4] == 0xbf);
+  CHECK(b[5] == 0x80);
+  CHECK(b.read_be<float>(4) == -1.0f);
+}
+
+TEST_CASE("unaligned access") {
+  auto b = ex::buffer(32);
+  for (size_t offset = 0; offset < 8; ++offset) {
+    b.write_le<uint64_t>(0x0102030405060708, offset + 1);
+    CHECK(b.read_le<uint64_t>(offset + 1) == 0x0102030405060708);
+    CHECK(b[offset + 1] == 0x08);
+    b.write_be<uint32_t>(0x0a0b0c0d, offset + 3);
+    CHECK(b.read_be<uint32_t>(offset + 3) == 0x0a0b0c0d);
+    CHECK(b[offset + 3] == 0x0a);
+    b.write_le(3.5, offset + 5);
+    CHECK(b.read_le<double>(offset + 5) == 3.5);
+
+    ex::shared_buffer sb(b, offset + 1);
+    sb.write_be<uint16_t>(0xbeef, 1);
+    CHECK(sb.read_be<uint16_t>(1) == 0xbeef);
+    CHECK(ex::buffer_read_le<uint16_t>(b.data() + offset + 2) == 0xefbe);
+  }
+  const auto cb = ex::buffer::from({1, 2, 3});
+  CHECK(cb.read_le<uint16_t>(1) == 0x0302);
+  CHECK(cb.read_be<uint16_t>(1) == 0x0203);
+
+  // Enums go through their underlying type, other trivially copyable
+  // types are copied (and for big endian reversed) as a whole.
+  enum class kind : uint16_t { ack = 0x0102 };
+  struct pair {
+    uint8_t a, b, c;
+  };
+  b.write_be(kind::ack, 1);
+  CHECK(b[1] == 0x01);
+  CHECK(b.read_be<kind>(1) == kind::ack);
+  CHECK(b.read_le<kind>(1) == static_cast<kind>(0x0201));
+  ex::shared_buffer sb(b);
+  sb.write_le(pair{1, 2, 3}, 4);
+  CHECK(sb.read_le<pair>(4).c == 3);
+  CHECK(sb.read_be<pair>(4).a == 3);
+  sb.write_be(pair{1, 2, 3}, 4);
+  CHECK(b[4] == 3);
+}
+
+template <typename T> static void check_be_n() {
+  for (size_t count : {0, 1, 3, 7, 8, 9, 16, 17, 33, 100}) {
+    auto b = ex::buffer(count * sizeof(T) + 1);
+    for (size_t i = 0; i < b.size(); ++i)
+      b[i] = static_cast<uint8_t>(i * 31 + 7);
+    std::vector<T> out(count);
+    b.read_be_n(out.data(), count, 1);
+    bool same = true;
+    for (size_t i = 0; i < count; ++i) {
+      auto e = b.read_be<T>(1 + i * sizeof(T));
+      same = same && !memcmp(&out[i], &e, sizeof(T));
+    }
+    CHECK(same);
+
+    auto w = ex::buffer(count * sizeof(T) + 1);
+    w.write_be_n(out.data(), count, 1);
+    CHECK(std::equal(w.begin() + 1, w.end(), b.begin() + 1));
+
+    ex::shared_buffer sb(w);
+    std::vector<T> le(count);
+    sb.read_le_n(le.data(), count, 1);
+    sb.write_le_n(le.data(), count, 0);
+    CHECK(std::equal(w.begin(), w.end() - 1, b.begin() + 1));
+  }
+}
+
+TEST_CASE("batch endian conversion") {
+  check_be_n<uint8_t>();
+  check_be_n<uint16_t>();
+  check_be_n<int16_t>();
+  check_be_n<uint32_t>();
+  check_be_n<float>();
+  check_be_n<uint64_t>();
+  check_be_n<double>();
+
+  uint16_t v[20];
+  for (uint16_t i = 0; i < 20; ++i)
+    v[i] = static_cast<uint16_t>(0x0100 * i + i + 1);
+  uint8_t raw[40];
+  ex::buffer_write_be_n(raw, v, 20);
+  CHECK(raw[0] == 0x00);
+  CHECK(raw[1] == 0x01);
+  CHECK(raw[38] == 0x13);
+  CHECK(raw[39] == 0x14);
+  ex::buffer_read_be_n(raw, reinterpret_cast<uint16_t *>(raw), 20);
+  CHECK(!memcmp(raw, v, sizeof(v)));
+}
+
+TEST_CASE("buffer_read_hex kernels") {
+  std::vector<uint8_t> v(1000);
+  for (size_t i = 0; i < v.size(); ++i)
+    v[i] = static_cast<uint8_t>(i * 7 + 3);
+  for (size_t n : {0, 1, 15, 16, 17, 31, 32, 33, 64, 255, 256, 257, 1000}) {
+    std::string expected(n * 2, '\0');
+    ex::_buffer_simd_::hex_encode_scalar(v.data(), n, &expected[0]);
+    std::string s(n * 2, '\0');
+    ex::_buffer_simd_::hex_encode(v.data(), n, &s[0]);
+    CHECK(s == expected);
+    CHECK(ex::buffer_read_hex(v.data(), n) == expected);
+
+    std::string split;
+    for (size_t i = 0; i < n; ++i) {
+      if (i)
+        split += "::";
+      split += expected.substr(i * 2, 2);
+    }
+    CHECK(ex::buffer_read_hex(v.data(), n, "::") == split);
+  }
+  auto b = ex::buffer::from({0x00, 0x9a, 0xaf, 0xff});
+  CHECK(b.to_hex_string() == "009aafff");
+  CHECK(b.to_hex_string(" ") == "00 9a af ff");
+  CHECK(b.read_hex(1) == "9aafff");
+  CHECK(b.read_hex(1, 2, "-") == "9a-af");
+  ex::shared_buffer sb(b);
+  CHECK(sb.read_hex(2) == "afff");
+  CHECK(sb.read_hex(0, 3, ":") == "00:9a:af");
+}
+
+TEST_CASE("buffer_write_hex decoder") {
+  std::vector<uint8_t> v(300);
+  for (size_t i = 0; i < v.size(); ++i)
+    v[i] = static_cast<uint8_t>(i * 13 + 5);
+  for (size_t n : {1, 15, 16, 17, 32, 33, 100, 300}) {
+    auto hex = ex::buffer_read_hex(v.data(), n);
+    std::vector<uint8_t> out(n);
+    CHECK(ex::buffer_write_hex(out.data(), hex, true) == std::string::npos);
+    CHECK(out == std::vector<uint8_t>(v.begin(), v.begin() + n));
+
+    std::string upper = hex;
+    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
+    std::fill(out.begin(), out.end(), 0);
+    CHECK(ex::buffer_write_hex(out.data(), upper) == std::string::npos);
+    CHECK(out == std::vector<uint8_t>(v.begin(), v.begin() + n));
+
+    auto split = ex::buffer_read_hex(v.data(), n, ", ");
+    std::fill(out.begin(), out.end(), 0);
+    CHECK(ex::buffer_write_hex(out.data(), split) == std::string::npos);
+    CHECK(out == std::vector<uint8_t>(v.begin(), v.begin() + n));
+    CHECK(ex::buffer_hex_size(split) == n);
+
+    if (n > 1) {
+      auto bad = hex;
+      bad[n + 1] = 'g';
+      CHECK(ex::buffer_write_hex(out.data(), bad, true) == n + 1);
+      CHECK(ex::buffer_write_hex(out.data(), split, true) == 2);
+    }
+  }
+
+  uint8_t b[2] = {0};
+  CHECK(ex::buffer_write_hex(b, "abc", true) == std::string::npos);
+  CHECK(b[0] == 0x0a);
+  CHECK(b[1] == 0xbc);
+  CHECK(ex::buffer_write_hex(b, "a:b:c") == std::string::npos);
+  CHECK(b[0] == 0x0a);
+  CHECK(b[1] == 0xbc);
+  CHECK(ex::buffer_write_hex(b, "x1", true) == 0);
+  CHECK(ex::buffer_write_hex(b, "1x2", true) == 1);
+  CHECK(ex::buffer::from_hex("3c:fa:d3").size() == 3);
+  CHECK(ex::buffer::from_hex("").size() == 0);
+}
+
 TEST_CASE("buffer::from") {
   std::array<uint8_t, 4> arr = {1, 2, 3, 4};
   auto b = ex::buffer::from(arr, 2);
@@ -161,6 +368,70 @@ TEST_CASE("buffer::from") {
   CHECK((b[3] == 0x64));
 }
 
+template <typename B, typename = void>
+constexpr bool has_uninitialized = false;
+template <typename B>
+constexpr bool has_uninitialized<
+    B, std::void_t<decltype(B::uninitialized(1))>> = true;
+
+TEST_CASE("buffer uninitialized growth") {
+  static_assert(has_uninitialized<ex::basic_buffer<>>);
+  static_assert(has_uninitialized<ex::pmr_buffer>);
+  static_assert(!has_uninitialized<ex::buffer>);
+
+  auto b = ex::basic_buffer<>::uninitialized(16);
+  CHECK(b.size() == 16);
+  b.fill({1, 2, 3, 4});
+  b.resize_uninitialized(2);
+  b.resize_uninitialized(4);
+  CHECK(b.size() == 4);
+  CHECK(b[0] == 1);
+  CHECK(b[1] == 2);
+  b.resize(8);
+  for (size_t i = 4; i < 8; ++i)
+    CHECK(b[i] == 0);
+  b.resize(10, 0xff);
+  CHECK(b[9] == 0xff);
+
+  ex::buffer z(5);
+  for (auto c : z)
+    CHECK(c == 0);
+  ex::buffer f(3, 7);
+  CHECK(f.to_hex_string() == "070707");
+  CHECK(ex::buffer::from(std::vector<uint16_t>{1, 2}).to_hex_string() ==
+        "01020000");
+
+  // ex::buffer is still a std::vector<uint8_t>.
+  std::vector<uint8_t> &v = z;
+  v.resize(7);
+  v.emplace_back();
+  CHECK(z.size() == 8);
+  CHECK(std::all_of(z.begin(), z.end(), [](uint8_t c) { return c == 0; }));
+  std::vector<uint8_t> moved = std::move(z);
+  CHECK(moved.size() == 8);
+  f.swap(moved);
+  CHECK(f.size() == 8);
+  CHECK(moved.size() == 3);
+
+  // ex::buffer::from_hex decodes in chunks; compare it with the direct
+  // decode across chunk boundaries, odd lengths and splitters.
+  std::string hex;
+  for (size_t i = 0; i < 5001; ++i)
+    hex += "0123456789abcdefABCDEF"[i * 7 % 22];
+  for (size_t n : {0, 1, 2, 2047, 2048, 2049, 4096, 5001}) {
+    auto digits = hex.substr(0, n);
+    std::string split;
+    for (size_t i = 0; i < n; ++i)
+      split += i % 2 ? std::string(1, digits[i]) + ":" : digits.substr(i, 1);
+    auto expected = ex::basic_buffer<>::from_hex(digits);
+    CHECK(expected.size() == (n + 1) / 2);
+    auto a = ex::buffer::from_hex(digits);
+    CHECK(std::equal(expected.begin(), expected.end(), a.begin(), a.end()));
+    auto b = ex::buffer::from_hex(split);
+    CHECK(std::equal(expected.begin(), expected.end(), b.begin(), b.end()));
+  }
+}
+
 TEST_CASE("shared_buffer::write") {
   ex::buffer b(10);
   b.write_le<uint8_t>(0xff, 0);
@@ -395,6 +666,1063 @@ TEST_CASE("buffer operator=") {
   CHECK(z.to_hex_string() == "01fad3b00001");
 }
 
+TEST_CASE("ref_buffer") {
+  ex::ref_buffer frame;
+  {
+    auto b = ex::buffer::from_hex("0102030405060708");
+    frame = ex::ref_buffer(std::move(b));
+  }
+  CHECK(frame.size() == 8);
+  CHECK(frame.use_count() == 1);
+  CHECK(frame.read_be<uint16_t>() == 0x0102);
+
+  auto body = frame.slice(2, 4);
+  CHECK(frame.use_count() == 2);
+  CHECK(body.to_hex_string() == "03040506");
+  CHECK(body.data() == frame.data() + 2);
+  auto tail = body.slice(3);
+  CHECK(tail.size() == 1);
+  CHECK(tail[0] == 6);
+  CHECK_THROWS_AS(body.slice(3, 2), std::out_of_range);
+  CHECK_THROWS_AS(body.slice(5), std::out_of_range);
+
+  body.write_be<uint16_t>(0xaabb, 0);
+  CHECK(frame.read_hex(0, 0, ":") == "01:02:aa:bb:05:06:07:08");
+
+  frame = ex::ref_buffer();
+  CHECK(frame.size() == 0);
+  CHECK(body.use_count() == 2);
+
+  std::thread t([sub = std::move(body)] {
+    CHECK(sub.read_be<uint32_t>() == 0xaabb0506);
+  });
+  t.join();
+  CHECK(tail.use_count() == 1);
+  CHECK(tail.to_buffer().to_hex_string() == "06");
+
+  auto moved = std::move(tail);
+  CHECK(tail.size() == 0);
+  CHECK(tail.data() == nullptr);
+  CHECK(moved[0] == 6);
+
+  auto copied = ex::ref_buffer::from({1, 2, 3});
+  CHECK(copied.to_hex_string() == "010203");
+  CHECK(ex::ref_buffer::from(std::string("ab")).to_string() == "ab");
+  CHECK(ex::ref_buffer(4).to_hex_string() == "00000000");
+}
+
+TEST_CASE("buffer_chain") {
+  ex::buffer_chain chain;
+  chain.append(ex::buffer::from_hex("0102"));
+  chain.append(ex::buffer::from_hex("030405"));
+  uint8_t raw[] = {6, 7, 8, 9};
+  chain.append(ex::shared_buffer(raw));
+  chain.prepend(ex::buffer::from_hex("00"));
+  chain.append(ex::buffer());
+  CHECK(chain.size() == 10);
+  CHECK(chain.segment_count() == 4);
+  CHECK(chain.at(0) == 0);
+  CHECK(chain.at(9) == 9);
+  CHECK_THROWS_AS(chain.at(10), std::out_of_range);
+
+  CHECK(chain.read_be<uint16_t>(1) == 0x0102);
+  CHECK(chain.read_be<uint32_t>(1) == 0x01020304);
+  CHECK(chain.read_le<uint64_t>(2) == 0x0908070605040302);
+  CHECK(chain.read_be<uint16_t>(8) == 0x0809);
+  CHECK_THROWS_AS(chain.read_be<uint16_t>(9), std::out_of_range);
+  enum class word : uint16_t { straddle = 0x0203 };
+  CHECK(chain.read_be<word>(2) == word::straddle);
+  struct triple {
+    uint8_t a, b, c;
+  };
+  auto t = chain.read_be<triple>(2);
+  CHECK(t.a == 4);
+  CHECK(t.c == 2);
+
+  CHECK(chain.to_hex_string() == "00010203040506070809");
+  CHECK(chain.read_hex(2, 4, ":") == "02:03:04:05");
+  CHECK(chain.read_hex(0, 0, "-") == "00-01-02-03-04-05-06-07-08-09");
+  CHECK(chain.read_hex(5, 3) == "050607");
+
+  chain.trim_front(2);
+  CHECK(chain.size() == 8);
+  CHECK(chain.segment_count() == 3);
+  CHECK(chain.read_be<uint16_t>() == 0x0203);
+  chain.trim_back(3);
+  CHECK(chain.to_hex_string() == "0203040506");
+  CHECK(chain.segment_count() == 3);
+  CHECK_THROWS_AS(chain.trim_back(6), std::out_of_range);
+
+  ex::buffer_chain other;
+  other.append(ex::ref_buffer::from({0xaa}));
+  chain.append(std::move(other));
+  CHECK(other.empty());
+  CHECK(chain.to_hex_string() == "0203040506aa");
+  auto &self = chain;
+  chain.append(std::move(self));
+  CHECK(chain.to_hex_string() == "0203040506aa");
+
+  auto &merged = chain.coalesce();
+  CHECK(chain.segment_count() == 1);
+  CHECK(merged.to_hex_string() == "0203040506aa");
+  raw[0] = 0;
+  CHECK(chain.to_buffer().to_hex_string() == "0203040506aa");
+  chain.trim_front(6);
+  CHECK(chain.empty());
+  CHECK(chain.segment_count() == 0);
+}
+
+TEST_CASE("buffer_reader") {
+  auto b = ex::buffer::from_hex("0001 00000002 03 aabbcc 0405");
+  ex::buffer_reader r(b);
+  CHECK(r.size() == 12);
+  REQUIRE(r.ensure(7));
+  CHECK(r.read_be<uint16_t>() == 1);
+  CHECK(r.read_be<uint32_t>() == 2);
+  CHECK(r.read_le<uint8_t>() == 3);
+  CHECK(r.position() == 7);
+  CHECK(r.remaining() == 5);
+
+  REQUIRE(r.ensure(3));
+  auto v = r.read_view(3);
+  CHECK(v.to_hex_string() == "aabbcc");
+  CHECK(v.data() == b.data() + 7);
+
+  uint16_t le = 0;
+  CHECK(r.try_read_le(le));
+  CHECK(le == 0x0504);
+  CHECK(r.remaining() == 0);
+
+  uint32_t x = 0;
+  CHECK_FALSE(r.try_read_be(x));
+  CHECK(r.failed());
+  r.seek(0);
+  CHECK_FALSE(r.ensure(1));
+  r.clear_error();
+  CHECK(r.ensure(12));
+  r.skip(7);
+  CHECK(r.read_hex(3, ":") == "aa:bb:cc");
+  uint8_t out[2];
+  r.read(out, 2);
+  CHECK(out[1] == 5);
+  r.seek(13);
+  CHECK(r.failed());
+
+  ex::shared_buffer sb(b, 7, 3);
+  ex::buffer_reader sr(sb);
+  CHECK(sr.ensure(3));
+  CHECK_FALSE(sr.ensure(4));
+  CHECK_FALSE(sr.ok());
+}
+
+TEST_CASE("buffer_writer") {
+  ex::buffer frame;
+  {
+    ex::buffer_writer w(frame, 32);
+    CHECK(w.capacity() >= 32);
+    auto data = frame.data();
+    auto len = w.placeholder<uint16_t>();
+    w.write_be<uint32_t>(0x01020304);
+    w.write_le<uint16_t>(0x0605);
+    w.write_hex("aa:bb");
+    uint8_t sum = 0;
+    for (auto c : w.view(2))
+      sum = static_cast<uint8_t>(sum + c);
+    auto crc = w.placeholder<uint8_t>();
+    w.patch_le(crc, sum);
+    w.patch_be(len, static_cast<uint16_t>(w.position() - 2));
+    CHECK(frame.data() == data);
+    CHECK(w.position() == 11);
+  }
+  CHECK(frame.to_hex_string() == "0009010203040506aabb7a");
+
+  ex::buffer grow = ex::buffer::from({0xff});
+  ex::buffer_writer w(grow);
+  std::vector<uint8_t> payload(1000, 0x11);
+  w.write(payload.data(), payload.size());
+  w.fill(0x22, 3);
+  w.write(ex::shared_buffer(payload, 0, 2));
+  auto &out = w.finish();
+  CHECK(&out == &grow);
+  CHECK(grow.size() == 1006);
+  CHECK(grow[0] == 0xff);
+  CHECK(grow[1000] == 0x11);
+  CHECK(grow[1001] == 0x22);
+  CHECK(grow[1005] == 0x11);
+  CHECK(w.view(1006).size() == 0);
+  CHECK_THROWS_AS(w.view(1007), std::out_of_range);
+
+  // Moving the buffer out leaves it alone when the writer goes away.
+  ex::buffer taken;
+  {
+    ex::buffer_writer w2(frame);
+    w2.write_be<uint16_t>(0x0102);
+    taken = std::move(frame);
+  }
+  CHECK(taken.size() == 13);
+  CHECK(frame.empty());
+}
+
+TEST_CASE("hexdump") {
+  auto mac = ex::buffer::from_hex("3cfad3b00001");
+  std::ostringstream os;
+  os << mac << 10;
+  CHECK(os.str() == "Buffer { 3c fa d3 b0 00 01 }10");
+  CHECK(ex::shared_buffer(mac).to_buffer_string() ==
+        "ex::shared_buffer (6) { 3c fa d3 b0 00 01 }");
+  CHECK(ex::buffer().hexdump() == "Buffer { }");
+
+  ex::hexdump_options cut;
+  cut.label = "mac";
+  cut.max_bytes = 2;
+  CHECK(mac.hexdump(cut) == "mac { 3c fa ... (4 more bytes) }");
+
+  auto text = ex::buffer::from("0123456789abcdef\x01XYZ");
+  ex::hexdump_options canonical;
+  canonical.style = ex::hexdump_style::canonical;
+  CHECK(text.hexdump(canonical) ==
+        "00000000  30 31 32 33 34 35 36 37  38 39 61 62 63 64 65 66  "
+        "|0123456789abcdef|\n"
+        "00000010  01 58 59 5a                                       "
+        "|.XYZ|\n"
+        "00000014\n");
+  canonical.max_bytes = 16;
+  CHECK(text.hexdump(canonical) ==
+        "00000000  30 31 32 33 34 35 36 37  38 39 61 62 63 64 65 66  "
+        "|0123456789abcdef|\n"
+        "... (4 more bytes)\n"
+        "00000014\n");
+  CHECK(ex::buffer().hexdump(canonical) == "00000000\n");
+
+  std::string sink = "> ";
+  ex::buffer_hexdump(sink, mac.data(), 2);
+  CHECK(sink == "> Buffer { 3c fa }");
+
+  std::vector<uint8_t> v(300);
+  for (size_t i = 0; i < v.size(); ++i)
+    v[i] = static_cast<uint8_t>(i * 7);
+  for (size_t n : {1, 15, 16, 17, 32, 33, 48, 100, 300}) {
+    std::string expected;
+    for (size_t i = 0; i < n; ++i) {
+      if (i)
+        expected += ' ';
+      expected += ex::buffer_read_hex(v.data() + i, 1);
+    }
+    CHECK(ex::buffer_read_hex(v.data(), n, " ") == expected);
+    ex::hexdump_options o;
+    o.label = "";
+    CHECK(ex::buffer_hexdump(v.data(), n, o) == " { " + expected + " }");
+  }
+}
+
+TEST_CASE("hex literals") {
+  using namespace ex::literals;
+  constexpr auto magic = "3c:fa:d3"_hex;
+  static_assert(magic.size() == 3);
+  static_assert(magic[0] == 0x3c && magic[1] == 0xfa && magic[2] == 0xd3);
+  constexpr auto odd = EX_HEX("abc");
+  static_assert(odd.size() == 2 && odd[0] == 0x0a && odd[1] == 0xbc);
+  static_assert(EX_HEX("3C FA-D3_b0").size() == 4);
+  static_assert(""_hex.size() == 0);
+  static_assert(ex::hex_literal_size("00:01:02") == 3);
+  CHECK_THROWS_AS(ex::hex_literal_size("3g"), std::invalid_argument);
+  CHECK_THROWS_AS(ex::hex_array<2>("3c"), std::invalid_argument);
+
+  static constexpr auto header = "3cfad3b00001"_hex;
+  static constexpr ex::const_buffer view(header);
+  static_assert(view.size() == 6);
+  static_assert(view.at(5) == 0x01 && view[0] == 0x3c);
+  static_assert(ex::const_buffer(magic).size() == 3);
+  CHECK(view.to_hex_string() == "3cfad3b00001");
+  CHECK(view.read_be<uint16_t>(0) == 0x3cfa);
+  CHECK(ex::buffer::from(header) == ex::buffer::from_hex("3cfad3b00001"));
+  auto copy = ex::buffer::from(header);
+  CHECK(view == ex::shared_buffer(copy));
+  CHECK(view != ex::const_buffer(magic));
+  CHECK(std::equal(view.begin(), view.end(), copy.begin(), copy.end()));
+}
+
+TEST_CASE("static_buffer") {
+  auto b = ex::static_buffer<16>::from_hex("3cfad3b00001");
+  CHECK(b.size() == 6);
+  CHECK(b.capacity() == 16);
+  CHECK(b.read_be<uint16_t>(0) == 0x3cfa);
+  b.write_be<uint16_t>(0x0102, 4);
+  CHECK(b.to_hex_string() == "3cfad3b00102");
+
+  auto copy = b;
+  b.fill({0xff});
+  CHECK(copy.data() != b.data());
+  CHECK(copy.to_hex_string() == "3cfad3b00102");
+  auto moved = std::move(copy);
+  CHECK(moved.to_hex_string() == "3cfad3b00102");
+  copy = b;
+  CHECK(copy.to_hex_string() == "fffad3b00102");
+
+  b.resize(8);
+  CHECK(b.read_le<uint16_t>(6) == 0);
+  CHECK_THROWS_AS(b.resize(17), std::length_error);
+  CHECK_THROWS_AS(ex::static_buffer<2>::from({1, 2, 3}),
+                  std::length_error);
+  CHECK(ex::static_buffer<4>::from(0x64636261).to_string() == "abcd");
+  CHECK(ex::static_buffer<4>::from("abc").to_string() == "abc");
+  // The factories give the same bytes as ex::buffer's.
+  std::vector<uint16_t> words = {0x0102, 0x0304};
+  std::string text = "ab";
+  uint16_t pair[] = {0x0102, 0x0304};
+  auto same = [](const auto &x, const ex::buffer &y) {
+    return x.to_hex_string() == y.to_hex_string();
+  };
+  CHECK(ex::buffer::from(words).to_hex_string() == "02040000");
+  CHECK(same(ex::static_buffer<16>::from(words), ex::buffer::from(words)));
+  CHECK(same(ex::small_buffer<16>::from(words), ex::buffer::from(words)));
+  CHECK(same(ex::static_buffer<16>::from(text), ex::buffer::from(text)));
+  CHECK(same(ex::small_buffer<16>::from(text), ex::buffer::from(text)));
+  CHECK(same(ex::static_buffer<16>::from(pair), ex::buffer::from(pair)));
+  CHECK(same(ex::small_buffer<16>::from(pair), ex::buffer::from(pair)));
+  CHECK(same(ex::static_buffer<16>::from(words, 3),
+             ex::buffer::from(words, 3)));
+  CHECK(same(ex::small_buffer<16>::from(words, 3),
+             ex::buffer::from(words, 3)));
+  CHECK(same(ex::static_buffer<16>::from(pair + 0, 2),
+             ex::buffer::from(pair + 0, 2)));
+  CHECK(same(ex::small_buffer<16>::from(pair + 0, 2),
+             ex::buffer::from(pair + 0, 2)));
+  CHECK(ex::buffer_reader(b).read_be<uint32_t>() == 0xfffad3b0);
+  std::ostringstream os;
+  os << ex::static_buffer<4>::from({1, 2});
+  CHECK(os.str() == "ex::static_buffer<4> (2) { 01 02 }");
+}
+
+TEST_CASE("small_buffer") {
+  ex::small_buffer<8> b;
+  CHECK(b.is_inline());
+  b.resize(4);
+  b.write_be<uint32_t>(0x01020304);
+  auto copy = b;
+  CHECK(copy.is_inline());
+  CHECK(copy.data() != b.data());
+
+  b.resize(64);
+  CHECK(!b.is_inline());
+  CHECK(b.capacity() >= 64);
+  CHECK(b.read_be<uint32_t>() == 0x01020304);
+  CHECK(b.read_le<uint64_t>(56) == 0);
+
+  auto data = b.data();
+  auto moved = std::move(b);
+  CHECK(moved.data() == data);
+  CHECK(b.is_inline());
+  CHECK(b.empty());
+
+  copy = moved;
+  CHECK(copy.size() == 64);
+  CHECK(copy.read_be<uint32_t>() == 0x01020304);
+  moved = std::move(copy);
+  CHECK(moved.size() == 64);
+  CHECK(copy.empty());
+
+  auto inline_moved = ex::small_buffer<8>::from({1, 2, 3});
+  auto dst = std::move(inline_moved);
+  CHECK(dst.is_inline());
+  CHECK(dst.to_hex_string() == "010203");
+  CHECK(ex::small_buffer<4>::from_hex("0102030405").to_hex_string() ==
+        "0102030405");
+}
+
+// ex::buffer stays a class, so code that forward declares it still builds.
+namespace ex {
+class buffer;
+}
+static size_t buffer_size(const ex::buffer &b) { return b.size(); }
+
+TEST_CASE("pmr_buffer") {
+  alignas(16) uint8_t storage[1024];
+  std::pmr::monotonic_buffer_resource arena(storage, sizeof(storage),
+                                            std::pmr::null_memory_resource());
+  auto in_arena = [&](const uint8_t *p) {
+    return p >= storage && p < storage + sizeof(storage);
+  };
+
+  ex::pmr_buffer b(16, &arena);
+  CHECK(in_arena(b.data()));
+  CHECK(b.read_le<uint64_t>(8) == 0);
+  b.write_be<uint32_t>(0x3cfad3b0);
+  CHECK(b.to_hex_string().substr(0, 8) == "3cfad3b0");
+
+  auto u = ex::pmr_buffer::uninitialized(32, &arena);
+  CHECK(u.size() == 32);
+  CHECK(in_arena(u.data()));
+  auto h = ex::pmr_buffer::from_hex("0102", &arena);
+  CHECK(in_arena(h.data()));
+  CHECK(h.read_be<uint16_t>() == 0x0102);
+  auto f = ex::pmr_buffer::from(h.data(), 2, &arena);
+  CHECK(f == h);
+  CHECK(ex::pmr_buffer::from({1, 2, 3}).size() == 3);
+
+  auto copy = h;
+  CHECK(!in_arena(copy.data()));
+  CHECK(copy == h);
+  std::ostringstream os;
+  os << h;
+  CHECK(os.str() == "Buffer { 01 02 }");
+  CHECK_THROWS_AS(ex::pmr_buffer(2048, &arena), std::bad_alloc);
+
+  {
+    ex::pmr_buffer p(100, &ex::thread_pool());
+    ex::pmr_buffer q(100, &ex::shared_pool());
+    auto first = p.data();
+    p = ex::pmr_buffer(&ex::thread_pool());
+    ex::pmr_buffer again(100, &ex::thread_pool());
+    CHECK(again.data() == first);
+  }
+  auto &arena1 = ex::thread_arena();
+  ex::pmr_buffer::uninitialized(64, &arena1);
+  std::thread([&] { CHECK(&ex::thread_arena() != &arena1); }).join();
+  arena1.release();
+
+  ex::buffer plain = ex::buffer::from_hex("0102");
+  CHECK(plain.to_hex_string() == h.to_hex_string());
+  static_assert(
+      std::is_same_v<decltype(ex::buffer::from({1, 2})), ex::buffer>);
+  CHECK(buffer_size(plain) == 2);
+}
+
+TEST_CASE("buffer_pool") {
+  ex::buffer_pool pool(2048, 64);
+  const uint8_t *first;
+  {
+    auto a = pool.acquire();
+    CHECK(a);
+    CHECK(a->size() == 2048);
+    a->write_be<uint32_t>(0x01020304);
+    CHECK(a.view().read_be<uint32_t>() == 0x01020304);
+    CHECK(ex::buffer_reader(*a).read_be<uint16_t>() == 0x0102);
+    first = a->data();
+  }
+  {
+    auto b = pool.acquire();
+    CHECK(b->data() == first);
+    b->resize(10);
+    auto moved = std::move(b);
+    CHECK(!b);
+  }
+  CHECK(pool.acquire()->size() == 2048);
+  auto s = pool.stats();
+  CHECK(s.hits == 2);
+  CHECK(s.misses == 1);
+  CHECK(s.allocated == 1);
+  CHECK(s.high_water == 1);
+
+  {
+    std::vector<ex::pooled_buffer> held;
+    for (int i = 0; i < 100; ++i)
+      held.push_back(pool.acquire());
+    auto kept = held.back().detach();
+    CHECK(kept.size() == 2048);
+    CHECK(!held.back());
+    CHECK(pool.stats().allocated == 99);
+    CHECK(held.back().detach().empty());
+    CHECK(ex::pooled_buffer().detach().empty());
+  }
+  s = pool.stats();
+  CHECK(s.high_water == 100);
+  CHECK(s.allocated <= 99);
+
+  // Buffers acquired on one thread and released on another.
+  constexpr int rounds = 4000;
+  std::atomic<bool> ok{true};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      std::vector<ex::pooled_buffer> batch;
+      for (int i = 0; i < rounds; ++i) {
+        auto b = pool.acquire();
+        b->write_le<uint32_t>(uint32_t(i * 4 + t));
+        if (b->read_le<uint32_t>() != uint32_t(i * 4 + t))
+          ok = false;
+        batch.push_back(std::move(b));
+        if (batch.size() == 8) {
+          std::thread([moved = std::move(batch)] {}).join();
+          batch.clear();
+        }
+      }
+    });
+  }
+  for (auto &t : threads)
+    t.join();
+  CHECK(ok);
+  s = pool.stats();
+  CHECK(s.hits + s.misses == 103 + 4 * rounds);
+  CHECK(s.high_water < 200);
+
+  // Handles may outlive their pool, on this thread or another.
+  ex::pooled_buffer late, remote;
+  {
+    ex::buffer_pool short_lived(64);
+    late = short_lived.acquire();
+    remote = short_lived.acquire();
+    short_lived.acquire();
+  }
+  late->write_le<uint32_t>(7);
+  CHECK(late->read_le<uint32_t>() == 7);
+  late.reset();
+  CHECK(!late);
+  std::thread([moved = std::move(remote)] {}).join();
+}
+
+TEST_CASE("ring_buffer") {
+  ex::ring_buffer ring(12);
+  CHECK(ring.capacity() == 16);
+  auto w = ring.write_regions();
+  CHECK(w.size() == 16);
+  CHECK(w.second.size() == 0);
+  w.first.write_be<uint32_t>(0x01020304);
+  ring.commit_write(4);
+  CHECK(ring.size() == 4);
+
+  auto r = ring.read_regions();
+  CHECK(r.size() == 4);
+  CHECK(r.first.read_be<uint32_t>() == 0x01020304);
+  ring.commit_read(4);
+  CHECK(ring.read_regions().empty());
+
+  // Wrap: 10 bytes from offset 4 fill the end, 2 more land at the start.
+  uint8_t in[14];
+  for (uint8_t i = 0; i < 14; ++i)
+    in[i] = i;
+  CHECK(ring.write(in, 14) == 14);
+  r = ring.read_regions();
+  CHECK(r.first.size() == 12);
+  CHECK(r.second.size() == 2);
+  CHECK(ring.write(in, 14) == 2);
+  CHECK(ring.write_regions().empty());
+
+  uint8_t out[16];
+  CHECK(ring.peek(out, 4, 10) == 4);
+  CHECK(ex::buffer_read_be<uint32_t>(out) == 0x0a0b0c0d);
+  CHECK(ring.read(out, 16) == 16);
+  CHECK(!memcmp(out, in, 14));
+  CHECK(out[14] == 0);
+  CHECK(out[15] == 1);
+  CHECK(ring.read(out, 1) == 0);
+
+  // A consumer polling for a 4-byte header that arrives in two commits.
+  ring.write(in, 2);
+  CHECK(ring.read_regions().size() == 2);
+  ring.write(in + 2, 2);
+  CHECK(ring.read_regions(4).size() == 4);
+  CHECK(ring.read_regions().size() == 4);
+  ring.commit_read(4);
+
+  // A producer and a consumer thread stream a counter through the ring.
+  ex::ring_buffer stream(64);
+  constexpr uint32_t count = 100000;
+  std::thread producer([&] {
+    for (uint32_t i = 0; i < count;) {
+      auto w = stream.write_regions(4);
+      if (w.size() < 4)
+        continue;
+      uint8_t v[4];
+      ex::buffer_write_be(v, i++);
+      auto first = std::min<size_t>(4, w.first.size());
+      memcpy(w.first.data(), v, first);
+      memcpy(w.second.data(), v + first, 4 - first);
+      stream.commit_write(4);
+    }
+  });
+  bool ordered = true;
+  for (uint32_t i = 0; i < count;) {
+    uint8_t v[4];
+    if (stream.peek(v, 4) < 4)
+      continue;
+    ordered = ordered && ex::buffer_read_be<uint32_t>(v) == i++;
+    stream.commit_read(4);
+  }
+  producer.join();
+  CHECK(ordered);
+  CHECK(stream.size() == 0);
+}
+
+TEST_CASE("mirrored_ring_buffer") {
+  ex::mirrored_ring_buffer ring(100);
+  auto n = ring.capacity();
+  CHECK(n >= 4096);
+  CHECK((n & (n - 1)) == 0);
+
+  // Move both indices to 3 bytes before the end of the storage.
+  auto w = ring.write_region();
+  CHECK(w.size() == n);
+  ring.commit_write(n - 3);
+  CHECK(ring.read_region().size() == n - 3);
+  ring.commit_read(n - 3);
+
+  w = ring.write_region(n);
+  CHECK(w.size() == n);
+  w.write_be<uint16_t>(0x0102, 0);
+  w.write_be<uint32_t>(0x03040506, 2);
+  ring.commit_write(6);
+
+  auto r = ring.read_region();
+  CHECK(r.size() == 6);
+  CHECK(r.read_be<uint16_t>(0) == 0x0102);
+  CHECK(r.read_be<uint32_t>(2) == 0x03040506);
+  CHECK(r.to_hex_string() == "010203040506");
+  // The bytes past the end are the start of the same memory.
+  CHECK(w.data() + n - (n - 3) == r.data() + 3);
+  CHECK(ex::buffer_read_be<uint16_t>(r.data() + 3 - n) == 0x0405);
+  ring.commit_read(6);
+
+  std::vector<uint8_t> in(n), out(n);
+  for (size_t i = 0; i < n; ++i)
+    in[i] = static_cast<uint8_t>(i * 7);
+  CHECK(ring.write(in.data(), n + 1) == n);
+  CHECK(ring.write_region().size() == 0);
+  CHECK(ring.read(out.data(), n) == n);
+  CHECK(in == out);
+  CHECK(ring.size() == 0);
+}
+
+TEST_CASE("mapped_buffer") {
+  char path[] = "/tmp/ex_mapped_buffer_XXXXXX";
+  int fd = mkstemp(path);
+  REQUIRE(fd >= 0);
+  close(fd);
+
+  CHECK(ex::mapped_buffer::open_readonly(path).size() == 0);
+  {
+    auto rw = ex::mapped_buffer::open_readwrite(path, 10000);
+    CHECK(rw.writable());
+    CHECK(rw.size() == 10000);
+    rw.write_hex("3cfad3b00001");
+    rw.write_be<uint32_t>(0xdeadbeef, 9996);
+    CHECK(rw.advise(ex::map_advice::willneed, 5000));
+    rw.advise(ex::map_advice::hugepage);
+    rw.sync();
+  }
+
+  auto ro = ex::mapped_buffer::open_readonly(path);
+  CHECK(!ro.writable());
+  CHECK(ro.size() == 10000);
+  CHECK(ro.advise(ex::map_advice::sequential));
+  CHECK(ro.read_hex(0, 6) == "3cfad3b00001");
+  CHECK(ro.read_be<uint32_t>(9996) == 0xdeadbeef);
+  CHECK(ex::buffer_reader(ro).read_be<uint16_t>() == 0x3cfa);
+  auto tail = ro.view(9996);
+  CHECK(tail.to_hex_string() == "deadbeef");
+  CHECK(ro.view(2, 2).to_hex_string() == "d3b0");
+  CHECK_THROWS_AS(ro.view(10001), std::out_of_range);
+  CHECK_THROWS_AS(ro.view(9999, 2), std::out_of_range);
+
+  auto moved = std::move(ro);
+  CHECK(ro.size() == 0);
+  CHECK(moved.read_be<uint32_t>(9996) == 0xdeadbeef);
+  CHECK(tail.data() == moved.data() + 9996);
+
+  unlink(path);
+  CHECK(moved.read_be<uint16_t>(0) == 0x3cfa);
+  CHECK_THROWS_AS(ex::mapped_buffer::open_readonly(path), std::system_error);
+}
+
+TEST_CASE("aligned_buffer") {
+  auto aligned = [](const void *p, size_t a) {
+    return reinterpret_cast<uintptr_t>(p) % a == 0;
+  };
+  for (size_t n : {1, 63, 64, 1000, 5000}) {
+    CHECK(aligned(ex::cache_aligned_buffer(n).data(), 64));
+    CHECK(aligned(ex::page_aligned_buffer::uninitialized(n).data(), 4096));
+    CHECK(aligned(ex::aligned_buffer<(2 << 20)>(n).data(), 2 << 20));
+  }
+  std::vector<uint8_t> src(100);
+  for (size_t i = 0; i < src.size(); ++i)
+    src[i] = static_cast<uint8_t>(i);
+  auto b = ex::cache_aligned_buffer::from(src.data(), src.size());
+  CHECK(aligned(b.data(), 64));
+  CHECK(b.read_be<uint32_t>(0) == 0x00010203);
+  b.resize(5000);
+  CHECK(aligned(b.data(), 64));
+  CHECK(b[99] == 99);
+  CHECK(b[4999] == 0);
+  auto h = ex::cache_aligned_buffer::from_hex("3cfad3b00001");
+  CHECK(h.to_hex_string() == "3cfad3b00001");
+  auto copy = h;
+  CHECK(aligned(copy.data(), 64));
+
+  ex::huge_page_buffer small(100);
+  CHECK(aligned(small.data(), 64));
+  auto big = ex::huge_page_buffer::uninitialized((size_t(2) << 20) + 1);
+  CHECK(aligned(big.data(), size_t(2) << 20));
+  big.write_be<uint64_t>(0x0102030405060708, big.size() - 8);
+  CHECK(big.read_be<uint64_t>(big.size() - 8) == 0x0102030405060708);
+  big.resize((size_t(4) << 20) + 1);
+  CHECK(aligned(big.data(), size_t(2) << 20));
+  CHECK(big.read_be<uint64_t>((size_t(2) << 20) - 7) == 0x0102030405060708);
+  big = ex::huge_page_buffer();
+  CHECK(big.empty());
+}
+
+TEST_CASE("varint") {
+  for (int64_t v : {int64_t(0), int64_t(-1), int64_t(1), int64_t(-64),
+                    INT64_MAX, INT64_MIN})
+    CHECK(ex::zigzag_decode(ex::zigzag_encode(v)) == v);
+  CHECK(ex::zigzag_encode(-1) == 1);
+  CHECK(ex::zigzag_encode(1) == 2);
+  CHECK(ex::zigzag_encode(INT64_MIN) == UINT64_MAX);
+
+  auto b = ex::buffer::from_hex("ac02");
+  uint64_t v;
+  CHECK(b.read_varint(v) == 2);
+  CHECK(v == 300);
+  CHECK(b.read_varint(v, 2) == 0);
+  CHECK(ex::buffer::from_hex("ffffffffffffffffff01").read_varint(v) == 10);
+  CHECK(v == UINT64_MAX);
+  CHECK(ex::buffer::from_hex("ffffffffffffffffff02").read_varint(v) == 0);
+  CHECK(ex::buffer::from_hex("ffffffffffffffffffff01").read_varint(v) == 0);
+  CHECK(ex::buffer::from_hex("8080").read_varint(v) == 0);
+
+  // Mixed lengths, weighted towards the short ones the batch path handles.
+  uint64_t state = 0x9e3779b97f4a7c15;
+  auto next = [&] {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  };
+  std::vector<uint64_t> values(5000);
+  for (auto &x : values) {
+    auto r = next();
+    auto bits = (r & 3) ? (r >> 2) % 15 : (r >> 2) % 65;
+    x = bits ? next() >> (64 - bits) : 0;
+  }
+  ex::buffer encoded;
+  {
+    ex::buffer_writer w(encoded);
+    for (auto x : values)
+      w.write_varint(x);
+  }
+  size_t size = 0;
+  for (auto x : values)
+    size += ex::buffer_varint_size(x);
+  CHECK(encoded.size() == size);
+
+  std::vector<uint64_t> decoded(values.size() + 1);
+  size_t consumed = 0;
+  CHECK(ex::buffer_read_varints(encoded.data(), encoded.size(),
+                                decoded.data(), decoded.size(),
+                                &consumed) == values.size());
+  CHECK(consumed == encoded.size());
+  decoded.pop_back();
+  CHECK(decoded == values);
+
+  CHECK(ex::buffer_read_varints(encoded.data(), encoded.size(),
+                                decoded.data(), 100, &consumed) == 100);
+  size = 0;
+  for (size_t i = 0; i < 100; ++i)
+    size += ex::buffer_varint_size(values[i]);
+  CHECK(consumed == size);
+
+  ex::buffer_reader r(encoded);
+  bool ok = true;
+  for (auto x : values)
+    ok = ok && r.try_read_varint(v) && v == x;
+  CHECK(ok);
+  CHECK(r.remaining() == 0);
+  CHECK_FALSE(r.try_read_varint(v));
+  CHECK(r.failed());
+
+  // A truncated last varint stops the batch before it.
+  encoded.push_back(0x80);
+  decoded.push_back(0);
+  CHECK(ex::buffer_read_varints(encoded.data(), encoded.size(),
+                                decoded.data(), decoded.size(),
+                                &consumed) == values.size());
+  CHECK(consumed == encoded.size() - 1);
+  ex::buffer_reader tail(encoded);
+  CHECK(tail.read_varints(decoded.data(), 100) == 100);
+  CHECK(tail.ok());
+  CHECK(tail.read_varints(decoded.data(), decoded.size()) ==
+        values.size() - 100);
+  CHECK(tail.remaining() == 1);
+  CHECK(tail.failed());
+  CHECK(tail.read_varints(decoded.data(), decoded.size()) == 0);
+
+  // Running out of input between varints is not an error.
+  ex::buffer_reader whole(encoded.data(), encoded.size() - 1);
+  CHECK(whole.read_varints(decoded.data(), decoded.size()) == values.size());
+  CHECK(whole.ok());
+}
+
+TEST_CASE("bit_reader") {
+  // MPEG-TS header: sync, TEI, PUSI, priority, 13-bit PID, 2+2+4 bits.
+  auto ts = ex::buffer::from_hex("4741001a");
+  ex::bit_reader r(ts);
+  CHECK(r.read(8) == 0x47);
+  CHECK(r.read(1) == 0);
+  CHECK(r.read(1) == 1);
+  r.skip(1);
+  CHECK(r.peek(13) == 0x100);
+  CHECK(r.read(13) == 0x100);
+  CHECK(r.read(2) == 0);
+  CHECK(r.read(2) == 1);
+  CHECK(r.read_signed(4) == -6);
+  CHECK(r.remaining() == 0);
+  CHECK(r.ok());
+  CHECK(r.read(1) == 0);
+  CHECK(r.failed());
+
+  ex::lsb_bit_reader l(ts);
+  CHECK(l.read(4) == 0x7);
+  CHECK(l.read(12) == 0x414);
+  l.seek(20);
+  CHECK(l.read(12) == 0x1a0);
+  l.seek(3);
+  CHECK(l.position() == 3);
+  l.align();
+  CHECK(l.position() == 8);
+  l.seek(33);
+  CHECK(l.failed());
+
+  // Random widths in both orders, checked against a bit-at-a-time reference.
+  uint64_t state = 0x2545f4914f6cdd1d;
+  auto next = [&] {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  };
+  std::vector<std::pair<uint64_t, unsigned>> fields;
+  size_t bits = 0;
+  while (bits < 8000) {
+    auto n = static_cast<unsigned>(next() % 64 + 1);
+    auto v = next() & (~uint64_t(0) >> (64 - n));
+    fields.emplace_back(v, n);
+    bits += n;
+  }
+  ex::buffer msb((bits + 7) / 8), lsb((bits + 7) / 8);
+  {
+    ex::bit_writer wm(msb);
+    ex::lsb_bit_writer wl(lsb);
+    for (auto &f : fields) {
+      wm.write(f.first, f.second);
+      wl.write(f.first, f.second);
+    }
+    CHECK(wm.position() == bits);
+    wm.write(0, 8);
+    CHECK(wm.failed());
+  }
+  size_t pos = 0;
+  bool same = true;
+  for (auto &f : fields) {
+    uint64_t m = 0, l = 0;
+    for (unsigned i = 0; i < f.second; ++i, ++pos) {
+      m = m << 1 | (msb[pos / 8] >> (7 - pos % 8) & 1);
+      l |= uint64_t(lsb[pos / 8] >> (pos % 8) & 1) << i;
+    }
+    same = same && m == f.first && l == f.first;
+  }
+  CHECK(same);
+
+  ex::bit_reader rm(msb);
+  ex::lsb_bit_reader rl(lsb);
+  same = true;
+  for (auto &f : fields)
+    same = same && rm.read(f.second) == f.first && rl.read(f.second) == f.first;
+  CHECK(same);
+  CHECK(rm.ok());
+  CHECK(rl.ok());
+  CHECK(rm.remaining() == msb.size() * 8 - bits);
+
+  // The writer leaves bytes past its cursor alone.
+  auto frame = ex::buffer::from_hex("ffffffffffff");
+  {
+    ex::bit_writer w(ex::shared_buffer(frame.data(), 6));
+    w.write(0x5, 3);
+    w.write_signed(-1, 6);
+    CHECK(w.finish() == 2);
+  }
+  CHECK(frame.to_hex_string() == "bf80ffffffff");
+}
+
+TEST_CASE("crc") {
+  const char *check = "123456789";
+  CHECK(ex::crc32(check, 9) == 0xcbf43926);
+  CHECK(ex::crc32c(check, 9) == 0xe3069283);
+  CHECK(ex::crc16_modbus(check, 9) == 0x4b37);
+  CHECK(ex::crc16_ccitt(check, 9) == 0x29b1);
+  CHECK(ex::crc16_ccitt(check, 9, 0) == 0x31c3);
+  CHECK(ex::crc32(check, 0) == 0);
+
+  auto b = ex::buffer::from(check);
+  ex::shared_buffer sb(b);
+  CHECK(ex::crc32(b) == 0xcbf43926);
+  CHECK(ex::crc32c(sb) == 0xe3069283);
+  CHECK(ex::crc16_modbus(b) == 0x4b37);
+  CHECK(ex::crc16_ccitt(sb) == 0x29b1);
+  CHECK(ex::crc32c(ex::shared_buffer(b.data() + 4, 5),
+                   ex::crc32c(b.data(), 4)) == 0xe3069283);
+  CHECK(ex::crc16_modbus(b.data() + 2, 7, ex::crc16_modbus(b.data(), 2)) ==
+        0x4b37);
+
+  // The accelerated paths against the table-driven ones, across
+  // alignments, fold boundaries and split points.
+  ex::buffer data(2100);
+  uint32_t x = 1;
+  for (auto &c : data) {
+    x = x * 1664525 + 1013904223;
+    c = static_cast<uint8_t>(x >> 24);
+  }
+  bool same = true;
+  for (size_t offset = 0; offset < 8; ++offset) {
+    for (size_t n = 0; n < 2048; n += n < 160 ? 1 : 61) {
+      auto p = data.data() + offset;
+      auto ieee = ~ex::_crc_::crc32_ieee_scalar(p, n, ~uint32_t(0));
+      auto c = ~ex::_crc_::crc32c_scalar(p, n, ~uint32_t(0));
+      auto split = n / 3;
+      same = same && ex::crc32(p, n) == ieee && ex::crc32c(p, n) == c &&
+             ex::crc32(p + split, n - split, ex::crc32(p, split)) == ieee &&
+             ex::crc32c(p + split, n - split, ex::crc32c(p, split)) == c;
+    }
+  }
+  CHECK(same);
+}
+
+TEST_CASE("buffer_hash") {
+  // wyhash final 4 test vectors; the seed is the vector's index.
+  CHECK(ex::buffer_hash("", 0, 0) == 0x93228a4de0eec5a2);
+  CHECK(ex::buffer_hash("a", 1, 1) == 0xc5bac3db178713c4);
+  CHECK(ex::buffer_hash("abc", 3, 2) == 0xa97f2f7b1d9b3314);
+  CHECK(ex::buffer_hash("message digest", 14, 3) == 0x786d1f1df3801df4);
+  std::string digits;
+  for (int i = 0; i < 8; ++i)
+    digits += "1234567890";
+  CHECK(ex::buffer_hash(digits.data(), digits.size(), 6) ==
+        0x6cc5eab49a92d617);
+
+  // Every length through the 16- and 48-byte block paths, and every byte,
+  // changes the hash.
+  std::vector<uint64_t> seen;
+  for (size_t n = 0; n <= 100; ++n) {
+    auto b = ex::buffer(n);
+    seen.push_back(ex::buffer_hash(b));
+    if (n)
+      for (size_t i = 0; i < n; ++i) {
+        b[i] = 1;
+        seen.push_back(ex::buffer_hash(b));
+        b[i] = 0;
+      }
+  }
+  std::sort(seen.begin(), seen.end());
+  CHECK(std::adjacent_find(seen.begin(), seen.end()) == seen.end());
+  CHECK(ex::buffer_hash("abc", 3, 1) != ex::buffer_hash("abc", 3, 2));
+
+  auto mac = ex::buffer::from_hex("3cfad3b00001");
+  auto frame = ex::buffer::from_hex("ffff3cfad3b00001ffff");
+  ex::shared_buffer view(frame.data() + 2, 6);
+  CHECK(view == ex::shared_buffer(mac));
+  CHECK(view != ex::shared_buffer(frame));
+  CHECK(std::hash<ex::buffer>{}(mac) == std::hash<ex::shared_buffer>{}(view));
+  CHECK(ex::buffer_hasher{}(mac) == ex::buffer_hasher{}(view));
+  CHECK(ex::buffer_equal{}(mac, view));
+  CHECK_FALSE(ex::buffer_equal{}(mac, frame));
+
+  std::unordered_map<ex::buffer, int> by_mac{{mac, 7}};
+  CHECK(by_mac.at(ex::buffer::from_hex("3cfad3b00001")) == 7);
+  std::unordered_set<ex::shared_buffer> views{view};
+  CHECK(views.count(ex::shared_buffer(mac)) == 1);
+  std::unordered_map<ex::buffer, int, ex::buffer_hasher, ex::buffer_equal>
+      transparent{{mac, 8}};
+#if defined(__cpp_lib_generic_unordered_lookup)
+  CHECK(transparent.find(view)->second == 8);
+#else
+  CHECK(transparent.find(ex::buffer::from(view.data(), view.size()))->second ==
+        8);
+#endif
+
+  std::map<ex::buffer, int, ex::buffer_less> ordered{
+      {mac, 1}, {ex::buffer::from_hex("3cfa"), 2}, {ex::buffer(), 3}};
+  CHECK(ordered.find(view)->second == 1);
+  CHECK(ordered.find(std::string_view("\x3c\xfa", 2))->second == 2);
+  CHECK(ordered.begin()->second == 3);
+  CHECK(ordered.find(ex::shared_buffer(frame)) == ordered.end());
+}
+
+TEST_CASE("buffer_find") {
+  // Small alphabets give many partial matches; every length covers the
+  // overlapping last block of each kernel.
+  uint32_t x = 1;
+  auto next = [&] { return (x = x * 1103515245 + 12345) >> 16; };
+  for (int round = 0; round < 2000; ++round) {
+    auto b = ex::buffer(next() % 200);
+    auto alphabet = 2 + next() % 4;
+    for (auto &c : b)
+      c = next() % 16 ? 'a' + next() % alphabet : next() & 0xff;
+    auto at = [&](auto it) {
+      return it == b.end() ? ex::buffer::npos
+                           : static_cast<size_t>(it - b.begin());
+    };
+
+    uint8_t byte = 'a' + next() % (alphabet + 1);
+    CHECK(b.find(byte) == at(std::find(b.begin(), b.end(), byte)));
+
+    std::string pattern;
+    for (auto n = next() % 6; n; --n)
+      pattern += static_cast<char>('a' + next() % alphabet);
+    auto expected = at(std::search(b.begin(), b.end(), pattern.begin(),
+                                   pattern.end()));
+    if (pattern.empty())
+      expected = 0;
+    CHECK(b.find(pattern) == expected);
+
+    std::vector<uint8_t> set{static_cast<uint8_t>(next()),
+                             static_cast<uint8_t>('a' + next() % alphabet),
+                             static_cast<uint8_t>(next() | 0x80)};
+    set.resize(1 + next() % 3);
+    CHECK(b.find_first_of(std::string_view(
+              reinterpret_cast<const char *>(set.data()), set.size())) ==
+          at(std::find_first_of(b.begin(), b.end(), set.begin(), set.end())));
+  }
+
+  auto b = ex::buffer::from(std::string_view("GET / HTTP/1.1\r\nHost: a\r\n"));
+  ex::shared_buffer view(b);
+  CHECK(view.find(' ') == 3);
+  CHECK(view.find(' ', 4) == 5);
+  CHECK(view.find('x') == ex::shared_buffer::npos);
+  CHECK(view.find(' ', 100) == ex::shared_buffer::npos);
+  CHECK(view.find("\r\n") == 14);
+  CHECK(view.find("\r\n", 15) == 23);
+  CHECK(view.find("") == 0);
+  CHECK(view.find(ex::shared_buffer(b.data() + 16, 4)) == 16);
+  CHECK(view.find_first_of(":\r") == 14);
+  CHECK(view.find_first_of(":\r", 15) == 20);
+  CHECK(view.find_first_of("") == ex::shared_buffer::npos);
+  CHECK(b.find("Host") == 16);
+
+  std::vector<std::string> lines;
+  for (auto line : b.split("\r\n"))
+    lines.push_back(line.to_string());
+  CHECK(lines == std::vector<std::string>{"GET / HTTP/1.1", "Host: a", ""});
+  lines.clear();
+  for (auto word : view.split(' '))
+    lines.push_back(word.to_string());
+  CHECK(lines.size() == 4);
+  CHECK(lines[1] == "/");
+
+  auto fields = ex::buffer::from(std::string_view(",a,,b"));
+  auto pieces = fields.split(',');
+  CHECK(std::distance(pieces.begin(), pieces.end()) == 4);
+  auto it = pieces.begin();
+  CHECK(it->size() == 0);
+  CHECK((++it)->data() == fields.data() + 1);
+  CHECK((++it)->size() == 0);
+  CHECK((++it)->to_string() == "b");
+  CHECK(++it == pieces.end());
+  auto whole = fields.split("");
+  CHECK(std::distance(whole.begin(), whole.end()) == 1);
+  auto empty = ex::buffer();
+  auto none = empty.split(',');
+  CHECK(std::distance(none.begin(), none.end()) == 1);
+}
+
 // int main() {
 //   testBufferUtils();
 //   testBufferFrom();